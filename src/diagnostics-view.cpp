@@ -0,0 +1,135 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "diagnostics-view.hpp"
+#include "diagnostics.hpp"
+#include "layout-store.hpp"
+
+#include <QDir>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSaveFile>
+#include <QVBoxLayout>
+
+static constexpr int refreshIntervalMs = 1000;
+
+DiagnosticsView::DiagnosticsView(QWidget *parent) : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    table = new QTableWidget(Diagnostics::phaseCount, 5, this);
+    table->setHorizontalHeaderLabels({"Count", "p50 (ms)", "p99 (ms)", "Max (ms)", "Mean (ms)"});
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    for (int row = 0; row < Diagnostics::phaseCount; ++row) {
+        table->setVerticalHeaderItem(row, new QTableWidgetItem(Diagnostics::phaseName(Diagnostics::Phase(row))));
+        for (int column = 0; column < table->columnCount(); ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem;
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, column, item);
+        }
+    }
+    layout->addWidget(table);
+
+    storeLabel = new QLabel(this);
+    layout->addWidget(storeLabel);
+
+    suspendLabel = new QLabel(this);
+    suspendLabel->setToolTip("Browser docks run in separate processes, so their savings only partly show up here");
+    layout->addWidget(suspendLabel);
+
+    sharedLabel = new QLabel(this);
+    sharedLabel->setToolTip("Changes made by other OBS instances that use the same plugin directory");
+    layout->addWidget(sharedLabel);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    buttonLayout->addStretch();
+
+    QPushButton *resetButton = new QPushButton("Reset", this);
+    resetButton->setToolTip("Clear all timings collected so far");
+    connect(resetButton, &QPushButton::clicked, this, &DiagnosticsView::resetStats);
+    buttonLayout->addWidget(resetButton);
+
+    QPushButton *exportButton = new QPushButton("Export", this);
+    exportButton->setToolTip("Save the timings and store statistics as JSON, e.g. to attach to a bug report");
+    connect(exportButton, &QPushButton::clicked, this, &DiagnosticsView::exportJson);
+    buttonLayout->addWidget(exportButton);
+
+    layout->addLayout(buttonLayout);
+
+    connect(&refreshTimer, &QTimer::timeout, this, &DiagnosticsView::refresh);
+    refreshTimer.setInterval(refreshIntervalMs);
+}
+
+void DiagnosticsView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    refreshTimer.start();
+}
+
+void DiagnosticsView::hideEvent(QHideEvent *event)
+{
+    // Nothing is read while the tab is hidden
+    refreshTimer.stop();
+    QWidget::hideEvent(event);
+}
+
+void DiagnosticsView::refresh()
+{
+    for (int row = 0; row < Diagnostics::phaseCount; ++row) {
+        const Diagnostics::PhaseStats stats = Diagnostics::stats(Diagnostics::Phase(row));
+        table->item(row, 0)->setText(QString::number(stats.count));
+        table->item(row, 1)->setText(QString::number(stats.p50Ns / 1e6, 'f', 2));
+        table->item(row, 2)->setText(QString::number(stats.p99Ns / 1e6, 'f', 2));
+        table->item(row, 3)->setText(QString::number(stats.maxNs / 1e6, 'f', 2));
+        table->item(row, 4)->setText(QString::number(stats.meanMs(), 'f', 2));
+    }
+
+    const LayoutStore::Stats stats = LayoutStore::instance().stats();
+    storeLabel->setText(QString("%1 layouts, %2 bytes stored as %3 in %4 chunks (dedup ratio %5x)")
+                            .arg(stats.layouts)
+                            .arg(stats.logicalBytes)
+                            .arg(stats.storedBytes)
+                            .arg(stats.chunks)
+                            .arg(stats.dedupRatio(), 0, 'f', 2));
+
+    using Diagnostics::Counter;
+    suspendLabel->setText(QString("%1 docks suspended now, %2 suspensions, %3 s suspended in total, %4 MB memory freed")
+                              .arg(Diagnostics::counter(Counter::SuspendedDocks))
+                              .arg(Diagnostics::counter(Counter::Suspensions))
+                              .arg(Diagnostics::counter(Counter::SuspendedDockMs) / 1000)
+                              .arg(Diagnostics::counter(Counter::ResidentBytesFreed) / (1024 * 1024)));
+
+    sharedLabel->setText(QString("%1 changes from other instances, %2 reloads, %3 write conflicts, %4 lock timeouts")
+                             .arg(Diagnostics::counter(Counter::ForeignChanges))
+                             .arg(Diagnostics::counter(Counter::SharedReloads))
+                             .arg(Diagnostics::counter(Counter::WriteConflicts))
+                             .arg(Diagnostics::counter(Counter::LockTimeouts)));
+}
+
+void DiagnosticsView::exportJson()
+{
+    QString exportPath = QFileDialog::getSaveFileName(this, "Export Diagnostics",
+                                                      QDir::home().filePath("obs-dock-layouts-diagnostics.json"),
+                                                      "JSON files (*.json)");
+    if (exportPath.isEmpty()) {
+        return; // User cancelled
+    }
+
+    QSaveFile file(exportPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(Diagnostics::toJson()) < 0 || !file.commit()) {
+        QMessageBox::warning(this, "Error", QString("Failed to export diagnostics to '%1'.").arg(exportPath));
+    }
+}
+
+void DiagnosticsView::resetStats()
+{
+    Diagnostics::reset();
+    refresh();
+}
@@ -0,0 +1,35 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QLabel>
+#include <QTableWidget>
+#include <QTimer>
+#include <QWidget>
+
+// "Diagnostics" tab of the layout dialog: the Diagnostics histograms and the
+// store statistics, refreshed once a second only while the tab is visible.
+class DiagnosticsView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsView(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    void refresh();
+    void exportJson();
+    void resetStats();
+
+    QTableWidget *table;
+    QLabel *storeLabel;
+    QLabel *suspendLabel;
+    QLabel *sharedLabel;
+    QTimer refreshTimer;
+};
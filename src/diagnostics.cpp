@@ -0,0 +1,215 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "diagnostics.hpp"
+#include "layout-store.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QtAlgorithms>
+
+#include <util/platform.h>
+
+#include <atomic>
+
+namespace Diagnostics {
+
+// Bucket 0 holds durations below 1 us, bucket b those below 2^b us; the last
+// one also takes everything longer (about 4.5 days)
+static constexpr int bucketCount = 40;
+
+struct Histogram {
+    std::atomic<qint64> totalNs{0};
+    std::atomic<qint64> maxNs{0};
+    std::atomic<quint64> buckets[bucketCount];
+};
+
+// Static storage, so the buckets start out zeroed
+static Histogram histograms[phaseCount];
+static std::atomic<qint64> counters[counterCount];
+
+static int bucket_for(qint64 ns)
+{
+    const quint64 us = quint64(qMax<qint64>(ns, 0)) / 1000;
+    if (us == 0)
+        return 0;
+    return qMin(64 - int(qCountLeadingZeroBits(us)), bucketCount - 1);
+}
+
+static qint64 bucket_upper_ns(int bucket)
+{
+    return (qint64(1) << bucket) * 1000;
+}
+
+static qint64 percentile_ns(const quint64 (&buckets)[bucketCount], quint64 count, qint64 maxNs, double fraction)
+{
+    if (count == 0)
+        return 0;
+
+    const quint64 rank = qMax<quint64>(1, quint64(double(count) * fraction + 0.999999));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < bucketCount; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank)
+            return qMin(bucket_upper_ns(bucket), maxNs);
+    }
+    return maxNs;
+}
+
+const char *phaseName(Phase phase)
+{
+    switch (phase) {
+    case Phase::FileLoad:
+        return "file_load";
+    case Phase::BlobDecode:
+        return "blob_decode";
+    case Phase::Apply:
+        return "apply";
+    case Phase::Repaint:
+        return "repaint";
+    case Phase::DiskSync:
+        return "disk_sync";
+    case Phase::Search:
+        return "search";
+    }
+    return "unknown";
+}
+
+const char *counterName(Counter counter)
+{
+    switch (counter) {
+    case Counter::SuspendedDocks:
+        return "suspended_docks";
+    case Counter::Suspensions:
+        return "suspensions";
+    case Counter::SuspendedDockMs:
+        return "suspended_dock_ms";
+    case Counter::ResidentBytesFreed:
+        return "resident_bytes_freed";
+    case Counter::ForeignChanges:
+        return "foreign_changes";
+    case Counter::SharedReloads:
+        return "shared_reloads";
+    case Counter::WriteConflicts:
+        return "write_conflicts";
+    case Counter::LockTimeouts:
+        return "lock_timeouts";
+    }
+    return "unknown";
+}
+
+void record(Phase phase, qint64 ns)
+{
+    Histogram &histogram = histograms[int(phase)];
+    histogram.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    histogram.buckets[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    qint64 maxNs = histogram.maxNs.load(std::memory_order_relaxed);
+    while (ns > maxNs && !histogram.maxNs.compare_exchange_weak(maxNs, ns, std::memory_order_relaxed)) {
+    }
+}
+
+PhaseStats stats(Phase phase)
+{
+    const Histogram &histogram = histograms[int(phase)];
+
+    // Not an atomic snapshot; a concurrent record() may be half counted
+    quint64 buckets[bucketCount];
+    quint64 count = 0;
+    for (int bucket = 0; bucket < bucketCount; ++bucket) {
+        buckets[bucket] = histogram.buckets[bucket].load(std::memory_order_relaxed);
+        count += buckets[bucket];
+    }
+
+    PhaseStats result;
+    result.count = count;
+    result.totalNs = histogram.totalNs.load(std::memory_order_relaxed);
+    result.maxNs = histogram.maxNs.load(std::memory_order_relaxed);
+    result.p50Ns = percentile_ns(buckets, count, result.maxNs, 0.50);
+    result.p99Ns = percentile_ns(buckets, count, result.maxNs, 0.99);
+    return result;
+}
+
+void reset()
+{
+    for (Histogram &histogram : histograms) {
+        histogram.totalNs.store(0, std::memory_order_relaxed);
+        histogram.maxNs.store(0, std::memory_order_relaxed);
+        for (std::atomic<quint64> &bucket : histogram.buckets)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void addToCounter(Counter counter, qint64 delta)
+{
+    counters[int(counter)].fetch_add(delta, std::memory_order_relaxed);
+}
+
+qint64 counter(Counter counter)
+{
+    return counters[int(counter)].load(std::memory_order_relaxed);
+}
+
+QByteArray toJson()
+{
+    QJsonObject phases;
+    for (int index = 0; index < phaseCount; ++index) {
+        const Phase phase = Phase(index);
+        const PhaseStats phaseStats = stats(phase);
+
+        QJsonArray buckets;
+        for (const std::atomic<quint64> &bucket : histograms[index].buckets)
+            buckets.append(double(bucket.load(std::memory_order_relaxed)));
+
+        QJsonObject entry;
+        entry["count"] = double(phaseStats.count);
+        entry["total_ms"] = phaseStats.totalNs / 1e6;
+        entry["mean_ms"] = phaseStats.meanMs();
+        entry["p50_ms"] = phaseStats.p50Ns / 1e6;
+        entry["p99_ms"] = phaseStats.p99Ns / 1e6;
+        entry["max_ms"] = phaseStats.maxNs / 1e6;
+        entry["buckets_us_log2"] = buckets;
+        phases[phaseName(phase)] = entry;
+    }
+
+    QJsonObject counterValues;
+    for (int index = 0; index < counterCount; ++index)
+        counterValues[counterName(Counter(index))] = double(counter(Counter(index)));
+
+    const LayoutStore::Stats storeStats = LayoutStore::instance().stats();
+    QJsonObject store;
+    store["layouts"] = storeStats.layouts;
+    store["chunks"] = storeStats.chunks;
+    store["logical_bytes"] = double(storeStats.logicalBytes);
+    store["stored_bytes"] = double(storeStats.storedBytes);
+    store["dedup_ratio"] = storeStats.dedupRatio();
+
+    QJsonObject root;
+    root["phases"] = phases;
+    root["counters"] = counterValues;
+    root["store"] = store;
+    root["resident_bytes"] = double(os_get_proc_resident_size());
+    return QJsonDocument(root).toJson();
+}
+
+QString summary()
+{
+    QStringList parts;
+    for (int index = 0; index < phaseCount; ++index) {
+        const PhaseStats phaseStats = stats(Phase(index));
+        if (phaseStats.count == 0)
+            continue;
+        parts.append(QStringLiteral("%1 %2x p50 %3 ms p99 %4 ms max %5 ms")
+                         .arg(QString::fromLatin1(phaseName(Phase(index))))
+                         .arg(phaseStats.count)
+                         .arg(phaseStats.p50Ns / 1e6, 0, 'f', 2)
+                         .arg(phaseStats.p99Ns / 1e6, 0, 'f', 2)
+                         .arg(phaseStats.maxNs / 1e6, 0, 'f', 2));
+    }
+    return parts.isEmpty() ? QStringLiteral("no operations timed") : parts.join(QStringLiteral(", "));
+}
+
+} // namespace Diagnostics
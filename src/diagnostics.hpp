@@ -0,0 +1,85 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QtGlobal>
+
+// Timing histograms for the phases of loading and switching layouts.
+//
+// Every phase has a fixed set of power-of-two microsecond buckets made of
+// relaxed atomics, so recording is a handful of uncontended increments from
+// any thread and nothing is computed until the numbers are read.
+namespace Diagnostics {
+
+enum class Phase {
+    FileLoad,   // Opening the database or migrating the INI
+    BlobDecode, // Reassembling and decompressing a value from its chunks
+    Apply,      // Blocking work of a layout switch or restoreState()
+    Repaint,    // The single repaint at the end of a switch
+    DiskSync,   // Writing and committing the database file
+    Search,     // Looking up one query in the layout search index
+};
+
+static constexpr int phaseCount = int(Phase::Search) + 1;
+
+// Running totals, not affected by reset()
+enum class Counter {
+    SuspendedDocks,     // Currently suspended
+    Suspensions,        // Docks suspended so far
+    SuspendedDockMs,    // Time resumed docks spent suspended
+    ResidentBytesFreed, // Drop in OBS memory measured after suspending
+    ForeignChanges,     // Journal records written by other OBS instances
+    SharedReloads,      // Database reloads after another instance compacted
+    WriteConflicts,     // Layouts changed here and elsewhere between syncs
+    LockTimeouts,       // Writes postponed because the lock stayed taken
+};
+
+static constexpr int counterCount = int(Counter::LockTimeouts) + 1;
+
+struct PhaseStats {
+    quint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    qint64 p50Ns = 0; // Upper bound of the bucket holding the percentile
+    qint64 p99Ns = 0;
+
+    double meanMs() const { return count ? totalNs / 1e6 / double(count) : 0.0; }
+};
+
+const char *phaseName(Phase phase);
+const char *counterName(Counter counter);
+
+void record(Phase phase, qint64 ns);
+PhaseStats stats(Phase phase);
+void reset();
+
+void addToCounter(Counter counter, qint64 delta);
+qint64 counter(Counter counter);
+
+// Every phase and counter plus the store statistics
+QByteArray toJson();
+
+// One line for the OBS log
+QString summary();
+
+// Records the lifetime of the scope
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Phase phase) : phase(phase) { timer.start(); }
+    ~ScopedTimer() { record(phase, timer.nsecsElapsed()); }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Phase phase;
+    QElapsedTimer timer;
+};
+
+} // namespace Diagnostics
@@ -0,0 +1,242 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "dock-index.hpp"
+#include "layout-store.hpp"
+#include "partial-layout.hpp"
+#include "screen-config.hpp"
+#include "window-state.hpp"
+
+#include <obs-module.h>
+
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QTimer>
+
+static const QString sessionDocksKey = QStringLiteral("SessionDocks");
+
+static QStringList layout_docks(const QString &name)
+{
+    QStringList docks;
+    if (PartialLayout::isPartial(name)) {
+        for (const PartialLayout::DockPlacement &placement : PartialLayout::placements(name))
+            docks.append(placement.objectName);
+    } else if (!WindowState::dockNames(LayoutStore::instance().windowState(name, ScreenConfig::instance().currentKey()),
+                                       docks)) {
+        docks.clear();
+    }
+    docks.removeDuplicates();
+    return docks;
+}
+
+DockIndex &DockIndex::instance()
+{
+    static DockIndex index;
+    return index;
+}
+
+void DockIndex::start(QMainWindow *window)
+{
+    if (mainWindow || !window)
+        return;
+    mainWindow = window;
+
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>())
+        presentDocks.insert(dock->objectName());
+
+    QElapsedTimer timer;
+    timer.start();
+    reindexAll();
+    blog(LOG_INFO, "Indexed the docks of %d layouts in %.2f ms, %d incomplete", int(docksByLayout.size()),
+         timer.nsecsElapsed() / 1e6, int(missingCount.size()));
+
+    LayoutStore &store = LayoutStore::instance();
+    connect(&store, &LayoutStore::layoutAdded, this, &DockIndex::indexLayout);
+    connect(&store, &LayoutStore::layoutChanged, this, &DockIndex::indexLayout);
+    connect(&store, &LayoutStore::layoutsReset, this, &DockIndex::onLayoutsReset);
+    connect(&store, &LayoutStore::layoutRemoved, this, &DockIndex::unindexLayout);
+    connect(&store, &LayoutStore::layoutRenamed, this, &DockIndex::onLayoutRenamed);
+    connect(&ScreenConfig::instance(), &ScreenConfig::changed, this, &DockIndex::reindexAll);
+
+    mainWindow->installEventFilter(this);
+}
+
+QStringList DockIndex::missingDocks(const QString &layoutName) const
+{
+    QStringList missing;
+    if (!missingCount.contains(layoutName))
+        return missing;
+
+    for (const QString &dock : docksByLayout.value(layoutName)) {
+        if (!presentDocks.contains(dock))
+            missing.append(dock);
+    }
+    missing.sort();
+    return missing;
+}
+
+QStringList DockIndex::layoutsUsing(const QString &dockName) const
+{
+    const QSet<QString> layouts = layoutsByDock.value(dockName);
+    QStringList names(layouts.begin(), layouts.end());
+    names.sort();
+    return names;
+}
+
+void DockIndex::saveSessionDocks()
+{
+    if (!mainWindow)
+        return;
+
+    // Scanned again, a dock may have gone since the last queued check
+    QStringList docks;
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>()) {
+        if (!dock->objectName().isEmpty())
+            docks.append(dock->objectName());
+    }
+    docks.removeDuplicates();
+    docks.sort();
+    LayoutStore::instance().setSetting(sessionDocksKey, docks.join('\n'));
+}
+
+bool DockIndex::lastSessionDocks(QSet<QString> &docks)
+{
+    const QStringList names = LayoutStore::instance().setting(sessionDocksKey).split('\n', Qt::SkipEmptyParts);
+    docks = QSet<QString>(names.begin(), names.end());
+    return !docks.isEmpty();
+}
+
+bool DockIndex::eventFilter(QObject *watched, QEvent *event)
+{
+    // Object names are set after parenting, and docks leave by being
+    // deleted or reparented, so look again once the batch is over
+    if (watched == mainWindow && (event->type() == QEvent::ChildAdded || event->type() == QEvent::ChildPolished ||
+                                  event->type() == QEvent::ChildRemoved))
+        queueDockCheck();
+
+    return QObject::eventFilter(watched, event);
+}
+
+bool DockIndex::updateLayout(const QString &name)
+{
+    const QStringList docks = layout_docks(name);
+    const QStringList previous = docksByLayout.value(name);
+    const int previousMissing = missingCount.value(name);
+
+    for (const QString &dock : previous) {
+        auto it = layoutsByDock.find(dock);
+        if (it != layoutsByDock.end()) {
+            it->remove(name);
+            if (it->isEmpty())
+                layoutsByDock.erase(it);
+        }
+    }
+
+    int missing = 0;
+    for (const QString &dock : docks) {
+        layoutsByDock[dock].insert(name);
+        if (!presentDocks.contains(dock))
+            ++missing;
+    }
+    docksByLayout.insert(name, docks);
+    if (missing > 0)
+        missingCount.insert(name, missing);
+    else
+        missingCount.remove(name);
+
+    return missing != previousMissing || (missing > 0 && docks != previous);
+}
+
+void DockIndex::indexLayout(const QString &name)
+{
+    if (updateLayout(name))
+        emit compatibilityChanged(name);
+}
+
+void DockIndex::onLayoutsReset(const QStringList &names)
+{
+    // Views reset on the same signal, so there is nothing to announce
+    for (const QString &name : names)
+        updateLayout(name);
+}
+
+void DockIndex::unindexLayout(const QString &name)
+{
+    for (const QString &dock : docksByLayout.take(name)) {
+        auto it = layoutsByDock.find(dock);
+        if (it != layoutsByDock.end()) {
+            it->remove(name);
+            if (it->isEmpty())
+                layoutsByDock.erase(it);
+        }
+    }
+    missingCount.remove(name);
+}
+
+void DockIndex::onLayoutRenamed(const QString &oldName, const QString &newName)
+{
+    const QStringList docks = docksByLayout.take(oldName);
+    for (const QString &dock : docks) {
+        QSet<QString> &layouts = layoutsByDock[dock];
+        layouts.remove(oldName);
+        layouts.insert(newName);
+    }
+    docksByLayout.insert(newName, docks);
+    if (missingCount.contains(oldName))
+        missingCount.insert(newName, missingCount.take(oldName));
+}
+
+void DockIndex::reindexAll()
+{
+    for (const QString &name : LayoutStore::instance().layoutNames())
+        indexLayout(name);
+}
+
+void DockIndex::queueDockCheck()
+{
+    if (checkQueued)
+        return;
+
+    checkQueued = true;
+    QTimer::singleShot(0, this, [this]() {
+        checkQueued = false;
+        checkDocks();
+    });
+}
+
+void DockIndex::checkDocks()
+{
+    if (!mainWindow)
+        return;
+
+    // Floating tab groups reparent docks, so search recursively
+    QSet<QString> docks;
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>())
+        docks.insert(dock->objectName());
+    if (docks == presentDocks)
+        return;
+
+    QSet<QString> affected;
+    for (const QString &dock : docks) {
+        if (presentDocks.contains(dock))
+            continue;
+        for (const QString &layout : layoutsByDock.value(dock)) {
+            if (--missingCount[layout] <= 0)
+                missingCount.remove(layout);
+            affected.insert(layout);
+        }
+    }
+    for (const QString &dock : presentDocks) {
+        if (docks.contains(dock))
+            continue;
+        for (const QString &layout : layoutsByDock.value(dock)) {
+            ++missingCount[layout];
+            affected.insert(layout);
+        }
+    }
+    presentDocks = docks;
+
+    for (const QString &layout : affected)
+        emit compatibilityChanged(layout);
+}
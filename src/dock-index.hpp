@@ -0,0 +1,72 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QEvent>
+#include <QHash>
+#include <QMainWindow>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Which layouts place which docks, and which of those docks exist.
+//
+// Each layout's dock names are read once, from the state for the current
+// screens (or the placements of a partial layout), and kept up to date
+// through the store's signals. Docks appearing on or leaving the main window
+// only touch the layouts that name them, so asking whether a layout can be
+// restored completely is a hash lookup.
+class DockIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DockIndex &instance();
+
+    // Indexes every layout and follows the store and the main window
+    void start(QMainWindow *mainWindow);
+
+    // Docks the layout places that the main window does not have, sorted
+    QStringList missingDocks(const QString &layoutName) const;
+    bool isComplete(const QString &layoutName) const { return missingCount.value(layoutName) == 0; }
+
+    QStringList layoutsUsing(const QString &dockName) const;
+
+    // Records the docks of this session, at exit, for the next startup
+    void saveSessionDocks();
+    // Docks the main window had at the end of the last session; false if
+    // that was never recorded
+    static bool lastSessionDocks(QSet<QString> &docks);
+
+signals:
+    // A layout became complete or incomplete, or its missing docks changed
+    void compatibilityChanged(const QString &layoutName);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    DockIndex() = default;
+
+    // Returns whether the layout's compatibility changed
+    bool updateLayout(const QString &name);
+    void indexLayout(const QString &name);
+    void onLayoutsReset(const QStringList &names);
+    void unindexLayout(const QString &name);
+    void onLayoutRenamed(const QString &oldName, const QString &newName);
+    void reindexAll();
+    void queueDockCheck();
+    void checkDocks();
+
+    QPointer<QMainWindow> mainWindow;
+    bool checkQueued = false;
+
+    QHash<QString, QSet<QString>> layoutsByDock;
+    QHash<QString, QStringList> docksByLayout;
+    QHash<QString, int> missingCount; // Layouts with none are left out
+    QSet<QString> presentDocks;
+};
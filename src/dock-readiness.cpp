@@ -0,0 +1,94 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "dock-readiness.hpp"
+
+#include <QChildEvent>
+#include <QDockWidget>
+
+DockReadinessWatcher::DockReadinessWatcher(QMainWindow *mainWindow, const QStringList &dockNames, int deadlineMs)
+    : QObject(mainWindow),
+      mainWindow(mainWindow),
+      pending(dockNames.begin(), dockNames.end())
+{
+    deadline.setSingleShot(true);
+    deadline.setInterval(deadlineMs);
+    connect(&deadline, &QTimer::timeout, this, [this]() {
+        checkDocks();
+        finish(pending.isEmpty());
+    });
+}
+
+void DockReadinessWatcher::start()
+{
+    elapsed.start();
+
+    // Docks that are already there need no waiting at all
+    checkDocks();
+    if (done)
+        return;
+
+    mainWindow->installEventFilter(this);
+    deadline.start();
+}
+
+QStringList DockReadinessWatcher::missingDocks() const
+{
+    QStringList missing(pending.begin(), pending.end());
+    missing.sort();
+    return missing;
+}
+
+bool DockReadinessWatcher::eventFilter(QObject *watched, QEvent *event)
+{
+    // A dock's object name is usually set after it was parented, so only
+    // look once the current batch of construction has finished
+    if (watched == mainWindow && (event->type() == QEvent::ChildAdded || event->type() == QEvent::ChildPolished))
+        queueCheck();
+
+    return QObject::eventFilter(watched, event);
+}
+
+void DockReadinessWatcher::queueCheck()
+{
+    if (checkQueued || done)
+        return;
+
+    checkQueued = true;
+    QTimer::singleShot(0, this, [this]() {
+        checkQueued = false;
+        checkDocks();
+    });
+}
+
+void DockReadinessWatcher::checkDocks()
+{
+    if (done)
+        return;
+    if (!mainWindow) {
+        finish(false);
+        return;
+    }
+
+    // Floating tab groups reparent docks, so search recursively
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>())
+        pending.remove(dock->objectName());
+
+    if (pending.isEmpty())
+        finish(true);
+}
+
+void DockReadinessWatcher::finish(bool allDocksReady)
+{
+    if (done)
+        return;
+
+    done = true;
+    deadline.stop();
+    if (mainWindow)
+        mainWindow->removeEventFilter(this);
+
+    emit finished(allDocksReady);
+    deleteLater();
+}
@@ -0,0 +1,50 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMainWindow>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+// Waits until every dock a saved state refers to exists on the main window.
+//
+// Instead of sleeping for a fixed time, it watches children being added to
+// and polished on the main window and re-checks once per event loop turn.
+// The watcher deletes itself after emitting finished().
+class DockReadinessWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    DockReadinessWatcher(QMainWindow *mainWindow, const QStringList &dockNames, int deadlineMs);
+
+    void start();
+
+    QStringList missingDocks() const;
+    qint64 elapsedMs() const { return elapsed.elapsed(); }
+    int deadlineMs() const { return deadline.interval(); }
+
+signals:
+    void finished(bool allDocksReady);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void queueCheck();
+    void checkDocks();
+    void finish(bool allDocksReady);
+
+    QPointer<QMainWindow> mainWindow;
+    QSet<QString> pending;
+    QTimer deadline;
+    QElapsedTimer elapsed;
+    bool checkQueued = false;
+    bool done = false;
+};
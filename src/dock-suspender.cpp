@@ -0,0 +1,141 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "dock-suspender.hpp"
+#include "diagnostics.hpp"
+#include "layout-store.hpp"
+#include "restore-scheduler.hpp"
+
+#include <obs-module.h>
+#include <obs-frontend-api.h>
+#include <util/platform.h>
+
+#include <QAction>
+#include <QMainWindow>
+#include <QTimer>
+
+static const QString suspendDocksKey = QStringLiteral("SuspendDocks");
+
+// Browsers take a moment to release their memory after closing
+static constexpr int memorySampleDelayMs = 2000;
+
+DockSuspender &DockSuspender::instance()
+{
+    static DockSuspender suspender;
+    return suspender;
+}
+
+QStringList DockSuspender::suspendedDocks(const QString &layoutName)
+{
+    const QString value = QString::fromUtf8(LayoutStore::instance().value(layoutName, suspendDocksKey));
+    return value.split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+}
+
+void DockSuspender::setSuspendedDocks(const QString &layoutName, const QStringList &dockNames)
+{
+    QByteArray value = dockNames.join(QLatin1Char('\n')).toUtf8();
+    if (value == LayoutStore::instance().value(layoutName, suspendDocksKey))
+        return;
+    LayoutStore::instance().setValue(layoutName, suspendDocksKey, value);
+}
+
+void DockSuspender::follow()
+{
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    if (!scheduler)
+        return;
+
+    connect(
+        scheduler, &RestoreScheduler::finished, this,
+        [this](const QString &name, bool ok) {
+            if (ok)
+                applyLayout(name);
+        },
+        Qt::UniqueConnection);
+}
+
+void DockSuspender::applyLayout(const QString &layoutName)
+{
+    const QStringList dockNames = suspendedDocks(layoutName);
+    if (dockNames.isEmpty())
+        return;
+
+    QMainWindow *mainWindow = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+    if (!mainWindow)
+        return;
+
+    const quint64 residentBefore = os_get_proc_resident_size();
+    int count = 0;
+    for (const QString &name : dockNames) {
+        QDockWidget *dock = mainWindow->findChild<QDockWidget *>(name);
+
+        // The toggle action is only unchecked for closed docks, not for
+        // docks behind another tab
+        if (dock && !dock->toggleViewAction()->isChecked() && suspend(dock))
+            ++count;
+    }
+
+    if (count == 0)
+        return;
+
+    blog(LOG_INFO, "Suspended %d hidden docks of layout '%s'", count, layoutName.toUtf8().constData());
+    QTimer::singleShot(memorySampleDelayMs, this, [this, residentBefore]() { measureFreedMemory(residentBefore); });
+}
+
+bool DockSuspender::suspend(QDockWidget *dock)
+{
+    const QString name = dock->objectName();
+    QWidget *content = dock->widget();
+
+    // Closing a widget that deletes itself would lose it for good
+    if (!content || content->testAttribute(Qt::WA_DeleteOnClose) || suspended.contains(name))
+        return false;
+
+    if (!content->close())
+        return false;
+
+    Suspended entry;
+    entry.dock = dock;
+    entry.content = content;
+    entry.since.start();
+    entry.visibilityConnection = connect(dock, &QDockWidget::visibilityChanged, this, [this, name](bool visible) {
+        if (visible)
+            resume(name);
+    });
+    suspended.insert(name, entry);
+
+    Diagnostics::addToCounter(Diagnostics::Counter::SuspendedDocks, 1);
+    Diagnostics::addToCounter(Diagnostics::Counter::Suspensions, 1);
+    return true;
+}
+
+void DockSuspender::resume(const QString &dockName)
+{
+    auto found = suspended.find(dockName);
+    if (found == suspended.end())
+        return;
+
+    Suspended entry = found.value();
+    suspended.erase(found);
+    disconnect(entry.visibilityConnection);
+
+    // Showing the content reloads a browser
+    if (entry.content)
+        entry.content->show();
+
+    Diagnostics::addToCounter(Diagnostics::Counter::SuspendedDocks, -1);
+    Diagnostics::addToCounter(Diagnostics::Counter::SuspendedDockMs, entry.since.elapsed());
+    blog(LOG_DEBUG, "Resumed dock '%s' after %lld ms", dockName.toUtf8().constData(), entry.since.elapsed());
+}
+
+void DockSuspender::measureFreedMemory(quint64 residentBefore)
+{
+    const quint64 residentAfter = os_get_proc_resident_size();
+    if (residentAfter >= residentBefore)
+        return;
+
+    const quint64 freed = residentBefore - residentAfter;
+    Diagnostics::addToCounter(Diagnostics::Counter::ResidentBytesFreed, qint64(freed));
+    blog(LOG_INFO, "Suspending docks freed %llu MB", (unsigned long long)(freed / (1024 * 1024)));
+}
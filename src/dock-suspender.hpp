@@ -0,0 +1,56 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+
+// Unloads the content of docks a layout marks as "suspend when hidden".
+//
+// After a layout is applied, every marked dock it closed gets its content
+// widget closed as well. Browser docks drop their browser on close, which
+// stops its rendering and frees its memory; other widgets are only hidden.
+// The content is shown again, and a browser reloaded, once the dock becomes
+// visible, whichever layout or menu action shows it.
+class DockSuspender : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DockSuspender &instance();
+
+    // Object names of the docks a layout suspends, kept as its
+    // "SuspendDocks" value
+    static QStringList suspendedDocks(const QString &layoutName);
+    static void setSuspendedDocks(const QString &layoutName, const QStringList &dockNames);
+
+    // Applies the marks of every layout the scheduler switches to
+    void follow();
+
+    // Suspends the marked docks that are closed now
+    void applyLayout(const QString &layoutName);
+
+private:
+    struct Suspended {
+        QPointer<QDockWidget> dock;
+        QPointer<QWidget> content;
+        QMetaObject::Connection visibilityConnection;
+        QElapsedTimer since;
+    };
+
+    DockSuspender() = default;
+
+    bool suspend(QDockWidget *dock);
+    void resume(const QString &dockName);
+    void measureFreedMemory(quint64 residentBefore);
+
+    bool following = false;
+    QHash<QString, Suspended> suspended;
+};
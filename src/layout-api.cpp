@@ -0,0 +1,286 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-api.hpp"
+#include "layout-store.hpp"
+#include "partial-layout.hpp"
+#include "restore-scheduler.hpp"
+#include "screen-config.hpp"
+
+#include <obs-module.h>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+
+#include <algorithm>
+
+static const char *switchedSignal = "void dock_layout_switched(string name, bool success, float duration_ms)";
+
+static bool parse_operations(const QByteArray &json, QVector<LayoutApi::Operation> &operations, QString &error)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (!document.isArray()) {
+        error = parseError.error != QJsonParseError::NoError ? parseError.errorString()
+                                                              : QStringLiteral("operations must be a JSON array");
+        return false;
+    }
+
+    for (const QJsonValue &value : document.array()) {
+        const QJsonObject object = value.toObject();
+        const QString op = object.value("op").toString();
+
+        LayoutApi::Operation operation;
+        operation.layout = object.value("layout").toString().trimmed();
+        if (op == QLatin1String("apply")) {
+            operation.kind = LayoutApi::Operation::Apply;
+        } else if (op == QLatin1String("save")) {
+            operation.kind = LayoutApi::Operation::Save;
+        } else if (op == QLatin1String("delete")) {
+            operation.kind = LayoutApi::Operation::Delete;
+        } else {
+            error = QStringLiteral("unknown operation '%1'").arg(op);
+            return false;
+        }
+        operations.append(operation);
+    }
+    return true;
+}
+
+// Runs on the UI thread; the caller waits for it
+struct Call {
+    QVector<LayoutApi::Operation> operations;
+    bool ok = false;
+    QString error;
+    QString current;
+};
+
+static void run_call(void *param)
+{
+    Call *call = static_cast<Call *>(param);
+    call->ok = LayoutApi::instance().run(call->operations, call->error);
+}
+
+static void get_current(void *param)
+{
+    Call *call = static_cast<Call *>(param);
+    call->current = LayoutApi::instance().currentLayout();
+}
+
+static void finish_call(calldata_t *data, Call &call)
+{
+    obs_queue_task(OBS_TASK_UI, run_call, &call, true);
+    calldata_set_bool(data, "success", call.ok);
+    calldata_set_string(data, "error", call.error.toUtf8().constData());
+}
+
+static void single_operation(calldata_t *data, LayoutApi::Operation::Kind kind)
+{
+    Call call;
+    call.operations.append(LayoutApi::Operation{kind, QString::fromUtf8(calldata_string(data, "name")).trimmed()});
+    finish_call(data, call);
+}
+
+static void proc_list(void *, calldata_t *data)
+{
+    // The store can be read from any thread
+    LayoutStore &store = LayoutStore::instance();
+    QJsonArray layouts;
+    for (const QString &name : store.layoutNames()) {
+        QJsonObject layout;
+        layout["name"] = name;
+        layout["partial"] = PartialLayout::isPartial(name);
+        layouts.append(layout);
+    }
+
+    QJsonObject root;
+    root["layouts"] = layouts;
+    root["default"] = store.defaultLayout();
+    calldata_set_string(data, "layouts", QJsonDocument(root).toJson(QJsonDocument::Compact).constData());
+}
+
+static void proc_get_current(void *, calldata_t *data)
+{
+    Call call;
+    obs_queue_task(OBS_TASK_UI, get_current, &call, true);
+    calldata_set_string(data, "name", call.current.toUtf8().constData());
+}
+
+static void proc_apply(void *, calldata_t *data)
+{
+    single_operation(data, LayoutApi::Operation::Apply);
+}
+
+static void proc_save(void *, calldata_t *data)
+{
+    single_operation(data, LayoutApi::Operation::Save);
+}
+
+static void proc_delete(void *, calldata_t *data)
+{
+    single_operation(data, LayoutApi::Operation::Delete);
+}
+
+static void proc_batch(void *, calldata_t *data)
+{
+    Call call;
+    const char *json = calldata_string(data, "operations");
+    if (!parse_operations(QByteArray(json ? json : ""), call.operations, call.error)) {
+        calldata_set_bool(data, "success", false);
+        calldata_set_string(data, "error", call.error.toUtf8().constData());
+        return;
+    }
+    finish_call(data, call);
+}
+
+LayoutApi &LayoutApi::instance()
+{
+    static LayoutApi api;
+    return api;
+}
+
+void LayoutApi::registerProcs()
+{
+    proc_handler_t *procs = obs_get_proc_handler();
+    proc_handler_add(procs, "void dock_layout_manager_list(out string layouts)", proc_list, nullptr);
+    proc_handler_add(procs, "void dock_layout_manager_get_current(out string name)", proc_get_current, nullptr);
+    proc_handler_add(procs, "void dock_layout_manager_apply(in string name, out bool success, out string error)",
+                     proc_apply, nullptr);
+    proc_handler_add(procs, "void dock_layout_manager_save(in string name, out bool success, out string error)",
+                     proc_save, nullptr);
+    proc_handler_add(procs, "void dock_layout_manager_delete(in string name, out bool success, out string error)",
+                     proc_delete, nullptr);
+    proc_handler_add(procs,
+                     "void dock_layout_manager_batch(in string operations, out bool success, out string error)",
+                     proc_batch, nullptr);
+
+    signal_handler_add(obs_get_signal_handler(), switchedSignal);
+}
+
+void LayoutApi::start(QMainWindow *window, RestoreScheduler *restoreScheduler)
+{
+    if (scheduler || !window || !restoreScheduler)
+        return;
+    mainWindow = window;
+    scheduler = restoreScheduler;
+
+    connect(scheduler, &RestoreScheduler::finished, this, &LayoutApi::onSwitchFinished);
+}
+
+QString LayoutApi::currentLayout() const
+{
+    return scheduler ? scheduler->currentLayout() : QString();
+}
+
+bool LayoutApi::run(const QVector<Operation> &operations, QString &error)
+{
+    if (!mainWindow || !scheduler) {
+        error = QStringLiteral("OBS has not finished loading");
+        return false;
+    }
+
+    LayoutStore &store = LayoutStore::instance();
+
+    // Checked up front, so a bad batch changes nothing
+    QSet<QString> removed, saved;
+    auto exists = [&](const QString &name) {
+        return saved.contains(name) || (!removed.contains(name) && store.contains(name));
+    };
+    for (const Operation &operation : operations) {
+        if (operation.layout.isEmpty()) {
+            error = QStringLiteral("an operation has no layout name");
+            return false;
+        }
+        if (operation.kind == Operation::Save) {
+            saved.insert(operation.layout);
+            removed.remove(operation.layout);
+        } else if (!exists(operation.layout)) {
+            error = QStringLiteral("layout '%1' does not exist").arg(operation.layout);
+            return false;
+        } else if (operation.kind == Operation::Delete) {
+            removed.insert(operation.layout);
+            saved.remove(operation.layout);
+        }
+    }
+
+    const QString screenKey = ScreenConfig::instance().currentKey();
+    QString wholeLayout;
+    QStringList partialLayouts;
+    for (const Operation &operation : operations) {
+        switch (operation.kind) {
+        case Operation::Save:
+            if (PartialLayout::isPartial(operation.layout)) {
+                QStringList dockNames;
+                for (const PartialLayout::DockPlacement &placement : PartialLayout::placements(operation.layout))
+                    dockNames.append(placement.objectName);
+                PartialLayout::setPlacements(operation.layout, PartialLayout::capture(mainWindow, dockNames));
+            } else {
+                store.setWindowState(operation.layout, mainWindow->saveState(), screenKey);
+            }
+            break;
+        case Operation::Delete:
+            store.removeLayout(operation.layout);
+            break;
+        case Operation::Apply:
+            // A whole-window layout replaces everything applied before it
+            if (PartialLayout::isPartial(operation.layout)) {
+                partialLayouts.append(operation.layout);
+            } else {
+                wholeLayout = operation.layout;
+                partialLayouts.clear();
+            }
+            break;
+        }
+    }
+
+    // Applied layouts deleted later in the batch are left out
+    partialLayouts.erase(std::remove_if(partialLayouts.begin(), partialLayouts.end(),
+                                        [&](const QString &name) { return !store.contains(name); }),
+                         partialLayouts.end());
+    if (!wholeLayout.isEmpty() && !store.contains(wholeLayout))
+        wholeLayout.clear();
+
+    if (wholeLayout.isEmpty()) {
+        if (!partialLayouts.isEmpty())
+            scheduler->applyPlan(partialLayouts.join(QStringLiteral(" + ")),
+                                 PartialLayout::plan(mainWindow, partialLayouts));
+        return true;
+    }
+
+    const QByteArray windowState = store.windowState(wholeLayout, screenKey);
+    if (windowState.isEmpty()) {
+        error = QStringLiteral("layout '%1' has no window state").arg(wholeLayout);
+        return false;
+    }
+
+    if (partialLayouts.isEmpty()) {
+        scheduler->switchTo(wholeLayout, windowState);
+        return true;
+    }
+
+    // One switch: the partial changes run after the window state is in
+    // place, before the single repaint
+    LayoutSwitcher::Plan plan = LayoutSwitcher::plan(mainWindow, windowState);
+    const LayoutSwitcher::Plan partialPlan = PartialLayout::plan(mainWindow, partialLayouts, true);
+    plan.changes += partialPlan.changes;
+    plan.changedDocks += partialPlan.changedDocks;
+
+    QStringList names = partialLayouts;
+    names.prepend(wholeLayout);
+    scheduler->applyPlan(names.join(QStringLiteral(" + ")), plan, wholeLayout);
+    return true;
+}
+
+void LayoutApi::onSwitchFinished(const QString &name, bool ok)
+{
+    calldata_t data;
+    calldata_init(&data);
+    calldata_set_string(&data, "name", name.toUtf8().constData());
+    calldata_set_bool(&data, "success", ok);
+    calldata_set_float(&data, "duration_ms", scheduler ? scheduler->lastDurationNs() / 1e6 : 0.0);
+    signal_handler_signal(obs_get_signal_handler(), "dock_layout_switched", &data);
+    calldata_free(&data);
+}
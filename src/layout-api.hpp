@@ -0,0 +1,68 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QMainWindow>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+
+class RestoreScheduler;
+
+// Procedures on the OBS proc handler, so scripts and show control tools can
+// manage layouts without the dialog:
+//
+//   dock_layout_manager_list(out string layouts)        JSON, see list()
+//   dock_layout_manager_get_current(out string name)
+//   dock_layout_manager_apply(in string name, out bool success, out string error)
+//   dock_layout_manager_save(in string name, out bool success, out string error)
+//   dock_layout_manager_delete(in string name, out bool success, out string error)
+//   dock_layout_manager_batch(in string operations, out bool success, out string error)
+//
+// A batch is a JSON array of {"op": "apply" | "save" | "delete", "layout":
+// name}. It is checked as a whole before anything runs; saves and deletes
+// then run in order, and all applies become a single switch at the end: the
+// last whole-window layout, with the partial layouts after it on top.
+//
+// Procedures may be called from any thread except the graphics thread; the
+// work is done on the UI thread and the call returns once it has started.
+// Every finished switch is announced on the core signal handler:
+//
+//   dock_layout_switched(string name, bool success, float duration_ms)
+class LayoutApi : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Operation {
+        enum Kind { Apply, Save, Delete };
+
+        Kind kind;
+        QString layout;
+    };
+
+    static LayoutApi &instance();
+
+    // Adds the procedures and the signal; the plugin has to be loaded
+    void registerProcs();
+
+    // Works on the window through the scheduler and announces its switches
+    // from now on; until then every call fails
+    void start(QMainWindow *mainWindow, RestoreScheduler *scheduler);
+
+    // On the UI thread; returns false and sets error if nothing was done
+    bool run(const QVector<Operation> &operations, QString &error);
+
+    QString currentLayout() const;
+
+private:
+    LayoutApi() = default;
+
+    void onSwitchFinished(const QString &name, bool ok);
+
+    QPointer<QMainWindow> mainWindow;
+    QPointer<RestoreScheduler> scheduler;
+};
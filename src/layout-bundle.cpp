@@ -0,0 +1,368 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-bundle.hpp"
+#include "layout-store.hpp"
+
+#include <obs-module.h>
+#include <util/crc32.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPointer>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+#include <QtEndian>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+// Bundle layout (all integers little-endian, strings as in the database):
+//
+//   header    "ODLB" | u32 version | u32 entry count
+//   entries   { u32 payload size | u32 CRC-32 of payload | payload } ...
+//   payload   string name | u32 value count { string key | u32 size | bytes } ...
+//   end       u32 0
+//
+// The end marker tells a complete bundle from a truncated one.
+static const char bundleMagic[4] = {'O', 'D', 'L', 'B'};
+static constexpr quint32 bundleVersion = 1;
+
+// A layout is a few KiB; anything this large is damage, not data
+static constexpr quint32 maxEntrySize = 64 * 1024 * 1024;
+
+// Layouts handed to the store per lock
+static constexpr int importBatchSize = 256;
+
+// Batches read ahead of the store, which bounds the memory of an import
+static constexpr int maxBatchesAhead = 4;
+
+namespace LayoutBundle {
+
+static void append_u32(QByteArray &out, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), 4);
+}
+
+static void append_string(QByteArray &out, const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    append_u32(out, quint32(utf8.size()));
+    out.append(utf8);
+}
+
+static bool read_u32(QIODevice &device, quint32 &value)
+{
+    uchar bytes[4];
+    if (device.read(reinterpret_cast<char *>(bytes), 4) != 4)
+        return false;
+    value = qFromLittleEndian<quint32>(bytes);
+    return true;
+}
+
+// Cursor over one entry's payload
+static bool take_u32(const QByteArray &payload, qint64 &pos, quint32 &value)
+{
+    if (pos + 4 > payload.size())
+        return false;
+    value = qFromLittleEndian<quint32>(payload.constData() + pos);
+    pos += 4;
+    return true;
+}
+
+static bool take_bytes(const QByteArray &payload, qint64 &pos, QByteArray &bytes)
+{
+    quint32 length;
+    if (!take_u32(payload, pos, length) || pos + length > payload.size())
+        return false;
+    bytes = payload.mid(pos, length);
+    pos += length;
+    return true;
+}
+
+static bool parse_entry(const QByteArray &payload, QString &name, QMap<QString, QByteArray> &values)
+{
+    qint64 pos = 0;
+    QByteArray text;
+    quint32 count;
+    if (!take_bytes(payload, pos, text) || !take_u32(payload, pos, count))
+        return false;
+    name = QString::fromUtf8(text);
+
+    for (quint32 i = 0; i < count; ++i) {
+        QByteArray bytes;
+        if (!take_bytes(payload, pos, text) || !take_bytes(payload, pos, bytes))
+            return false;
+        values.insert(QString::fromUtf8(text), bytes);
+    }
+    return !name.isEmpty() && pos == payload.size();
+}
+
+bool exportLayouts(const QString &path, const QStringList &names, QString &error)
+{
+    LayoutStore &store = LayoutStore::instance();
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    QStringList exported;
+    for (const QString &name : names) {
+        if (store.contains(name))
+            exported.append(name);
+    }
+
+    QByteArray header(bundleMagic, sizeof(bundleMagic));
+    append_u32(header, bundleVersion);
+    append_u32(header, quint32(exported.size()));
+    file.write(header);
+
+    // Only one layout is in memory at a time
+    for (const QString &name : exported) {
+        const QMap<QString, QByteArray> values = store.values(name);
+        QByteArray payload;
+        append_string(payload, name);
+        append_u32(payload, quint32(values.size()));
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            append_string(payload, it.key());
+            append_u32(payload, quint32(it.value().size()));
+            payload.append(it.value());
+        }
+
+        QByteArray frame;
+        append_u32(frame, quint32(payload.size()));
+        append_u32(frame, calc_crc32(0, payload.constData(), size_t(payload.size())));
+        file.write(frame);
+        file.write(payload);
+    }
+
+    QByteArray end;
+    append_u32(end, 0);
+    file.write(end);
+
+    // Write errors are sticky, so checking once at the end is enough
+    if (!file.commit()) {
+        error = file.errorString();
+        return false;
+    }
+
+    blog(LOG_INFO, "Exported %d dock layouts to '%s'", int(exported.size()), path.toUtf8().constData());
+    return true;
+}
+
+// State of an import, shared by the reader and the UI thread. The reader
+// only touches the semaphore and the cancel flag.
+struct ImportJob {
+    QString path;
+    ConflictPolicy policy = ConflictPolicy::Skip;
+    QPointer<QObject> context;
+    std::function<void(const ImportResult &)> done;
+    QElapsedTimer timer;
+    ImportResult result;
+
+    QSemaphore batchesAhead{maxBatchesAhead};
+    std::atomic<bool> cancelled{false};
+};
+
+// Readers run on their own pool so shutdown() can wait for them
+static QThreadPool &import_pool()
+{
+    static QThreadPool pool;
+    return pool;
+}
+
+// Imports whose finish_import() has not run yet; UI thread only
+static QVector<std::shared_ptr<ImportJob>> &live_jobs()
+{
+    static QVector<std::shared_ptr<ImportJob>> jobs;
+    return jobs;
+}
+
+// UI thread: resolves name conflicts against the store as it is now
+static void apply_batch(ImportJob &job, const LayoutStore::LayoutBatch &entries)
+{
+    job.batchesAhead.release();
+    if (job.cancelled)
+        return;
+
+    LayoutStore &store = LayoutStore::instance();
+    ImportResult &result = job.result;
+    LayoutStore::LayoutBatch batch;
+    batch.reserve(entries.size());
+    QSet<QString> taken; // Earlier batches are in the store already
+
+    for (const auto &entry : entries) {
+        QString name = entry.first;
+        if (store.contains(name) || taken.contains(name)) {
+            if (job.policy == ConflictPolicy::Skip) {
+                ++result.skipped;
+                continue;
+            }
+            if (job.policy == ConflictPolicy::Rename) {
+                QString base = name;
+                for (int suffix = 2; store.contains(name) || taken.contains(name); ++suffix)
+                    name = QStringLiteral("%1 (%2)").arg(base).arg(suffix);
+                ++result.renamed;
+            } else {
+                ++result.overwritten;
+            }
+        }
+
+        taken.insert(name);
+        batch.append(qMakePair(name, entry.second));
+        ++result.imported;
+    }
+
+    store.setLayouts(batch);
+}
+
+// UI thread
+static void finish_import(ImportJob &job, int corrupt, bool complete, quint32 count, const QString &error)
+{
+    QVector<std::shared_ptr<ImportJob>> &jobs = live_jobs();
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                              [&job](const std::shared_ptr<ImportJob> &live) { return live.get() == &job; }),
+               jobs.end());
+
+    ImportResult &result = job.result;
+    result.corrupt = corrupt;
+    result.error = error;
+    if (result.error.isEmpty() && job.cancelled)
+        result.error = QStringLiteral("The import was stopped");
+    else if (result.error.isEmpty() && !complete)
+        result.error = QStringLiteral("The bundle is truncated or damaged; %1 of %2 layouts were read")
+                           .arg(result.imported + result.skipped + result.corrupt)
+                           .arg(count);
+    result.elapsedMs = job.timer.elapsed();
+
+    blog(LOG_INFO, "Imported %d dock layouts from '%s' in %lld ms (%d overwritten, %d renamed, %d skipped, %d corrupt)",
+         result.imported, job.path.toUtf8().constData(), result.elapsedMs, result.overwritten, result.renamed,
+         result.skipped, result.corrupt);
+
+    if (job.context && job.done)
+        job.done(result);
+}
+
+// Worker thread: reads and verifies the entries, never the store
+static void read_bundle(const std::shared_ptr<ImportJob> &job)
+{
+    QObject *receiver = &LayoutStore::instance();
+    int corrupt = 0;
+    bool complete = false;
+    quint32 count = 0;
+    QString error;
+
+    auto finish = [&]() {
+        QMetaObject::invokeMethod(
+            receiver, [job, corrupt, complete, count, error]() { finish_import(*job, corrupt, complete, count, error); },
+            Qt::QueuedConnection);
+    };
+
+    QFile file(job->path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        finish();
+        return;
+    }
+
+    quint32 version;
+    if (file.read(sizeof(bundleMagic)) != QByteArray(bundleMagic, sizeof(bundleMagic)) || !read_u32(file, version) ||
+        !read_u32(file, count)) {
+        error = QStringLiteral("Not a dock layout bundle");
+        finish();
+        return;
+    }
+    if (version != bundleVersion) {
+        error = QStringLiteral("Unsupported bundle version %1").arg(version);
+        finish();
+        return;
+    }
+
+    LayoutStore::LayoutBatch batch;
+    auto handOver = [&]() {
+        // Waits while the UI thread is behind, so memory stays bounded
+        while (!job->batchesAhead.tryAcquire(1, 100)) {
+            if (job->cancelled)
+                return false;
+        }
+        QMetaObject::invokeMethod(
+            receiver, [job, batch]() { apply_batch(*job, batch); }, Qt::QueuedConnection);
+        batch.clear();
+        return true;
+    };
+
+    for (;;) {
+        if (job->cancelled)
+            break;
+
+        quint32 size, crc;
+        if (!read_u32(file, size))
+            break;
+        if (size == 0) {
+            complete = true;
+            break;
+        }
+        if (size > maxEntrySize || !read_u32(file, crc))
+            break;
+
+        const QByteArray payload = file.read(size);
+        if (payload.size() != qint64(size))
+            break;
+
+        QString name;
+        QMap<QString, QByteArray> values;
+        if (calc_crc32(0, payload.constData(), size_t(payload.size())) != crc || !parse_entry(payload, name, values)) {
+            ++corrupt;
+            continue;
+        }
+
+        batch.append(qMakePair(name, values));
+        if (batch.size() >= importBatchSize && !handOver())
+            break;
+    }
+
+    if (!batch.isEmpty())
+        handOver();
+    finish();
+}
+
+void importLayouts(const QString &path, ConflictPolicy policy, QObject *context,
+                   std::function<void(const ImportResult &)> done)
+{
+    auto job = std::make_shared<ImportJob>();
+    job->path = path;
+    job->policy = policy;
+    job->context = context;
+    job->done = std::move(done);
+    job->timer.start();
+
+    // The rest of the bundle is left out once nobody waits for it
+    if (context)
+        QObject::connect(context, &QObject::destroyed, [job]() { job->cancelled = true; });
+
+    live_jobs().append(job);
+    import_pool().start([job]() { read_bundle(job); });
+}
+
+void shutdown()
+{
+    for (const std::shared_ptr<ImportJob> &job : live_jobs()) {
+        job->cancelled = true;
+        job->context = nullptr;
+    }
+    import_pool().waitForDone();
+
+    // Runs what the readers queued while the store still takes layouts
+    QCoreApplication::sendPostedEvents(&LayoutStore::instance(), QEvent::MetaCall);
+}
+
+} // namespace LayoutBundle
@@ -0,0 +1,53 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+// Layout bundles: a single file with any number of layouts, for moving them
+// between machines.
+//
+// Bundles are written and read one layout at a time, so memory use does not
+// depend on the size of the bundle, and every entry carries its own CRC-32,
+// so a damaged entry only loses that layout. Imports read and verify the
+// bundle on a worker thread; the layouts reach the store on the UI thread
+// in batches (see LayoutStore::setLayouts), each announced once, and the
+// writer coalesces them into a single database rewrite.
+namespace LayoutBundle {
+
+enum class ConflictPolicy {
+    Skip,      // Keep the existing layout
+    Overwrite, // Replace the existing layout
+    Rename,    // Import as "Name (2)", "Name (3)", ...
+};
+
+struct ImportResult {
+    int imported = 0;    // Including overwritten and renamed ones
+    int overwritten = 0;
+    int renamed = 0;
+    int skipped = 0;
+    int corrupt = 0;     // Entries whose checksum did not match
+    qint64 elapsedMs = 0;
+    QString error;       // Set if the bundle could not be read at all
+};
+
+// Writes the given layouts; returns false and sets error on failure
+bool exportLayouts(const QString &path, const QStringList &names, QString &error);
+
+// Starts importing on a worker thread; UI thread only. done runs on the UI
+// thread when the import is over. Deleting context stops the import and
+// done is not called.
+void importLayouts(const QString &path, ConflictPolicy policy, QObject *context,
+                   std::function<void(const ImportResult &)> done);
+
+// Stops running imports and waits for their readers; call before
+// LayoutStore::shutdown(). done is not called for them.
+void shutdown();
+
+} // namespace LayoutBundle
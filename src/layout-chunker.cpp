@@ -0,0 +1,71 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-chunker.hpp"
+
+#include <QCryptographicHash>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+// saveState() blobs are a few KiB, so chunks are kept small
+static constexpr int minChunkSize = 64;
+static constexpr int maxChunkSize = 1024;
+static constexpr uint64_t boundaryMask = 0xff; // ~256 byte average
+
+// Pseudo-random gear table, generated with splitmix64 so it never changes
+// between builds (chunk boundaries are part of the on-disk format)
+static constexpr std::array<uint64_t, 256> makeGearTable()
+{
+    std::array<uint64_t, 256> table{};
+    uint64_t state = 0x4f444c4d; // "ODLM"
+    for (uint64_t &entry : table) {
+        state += 0x9e3779b97f4a7c15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        entry = z ^ (z >> 31);
+    }
+    return table;
+}
+
+static constexpr std::array<uint64_t, 256> gearTable = makeGearTable();
+
+QVector<int> LayoutChunker::split(const QByteArray &data)
+{
+    QVector<int> ends;
+    const auto *bytes = reinterpret_cast<const uint8_t *>(data.constData());
+    const int size = int(data.size());
+
+    int start = 0;
+    while (start < size) {
+        const int remaining = size - start;
+        if (remaining <= minChunkSize) {
+            ends.append(size);
+            break;
+        }
+
+        const int limit = start + std::min(remaining, maxChunkSize);
+        int end = limit;
+        uint64_t rolling = 0;
+        for (int i = start + minChunkSize; i < limit; ++i) {
+            rolling = (rolling << 1) + gearTable[bytes[i]];
+            if ((rolling & boundaryMask) == 0) {
+                end = i + 1;
+                break;
+            }
+        }
+
+        ends.append(end);
+        start = end;
+    }
+
+    return ends;
+}
+
+QByteArray LayoutChunker::hash(const char *data, int size)
+{
+    return QCryptographicHash::hash(QByteArrayView(data, size), QCryptographicHash::Sha1);
+}
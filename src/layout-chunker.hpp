@@ -0,0 +1,24 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+
+// Content-defined chunking of layout blobs.
+//
+// Boundaries are picked by a rolling gear hash over the bytes themselves, so
+// two saveState() blobs that only differ in a few dock sizes share all
+// chunks except the ones around the differences, even when an inserted dock
+// shifts everything after it.
+namespace LayoutChunker {
+
+// Returns the end offset of every chunk in data, in ascending order
+QVector<int> split(const QByteArray &data);
+
+// Content address of a chunk
+QByteArray hash(const char *data, int size);
+
+} // namespace LayoutChunker
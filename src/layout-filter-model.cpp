@@ -0,0 +1,111 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-filter-model.hpp"
+#include "layout-list-model.hpp"
+#include "layout-search.hpp"
+
+#include <QTimer>
+
+LayoutFilterModel::LayoutFilterModel(QObject *parent) : QSortFilterProxyModel(parent)
+{
+    setSortRole(LayoutListModel::RecentRankRole);
+    setDynamicSortFilter(true);
+    sort(0);
+
+    // A batch of store changes becomes one new lookup
+    connect(&LayoutSearch::instance(), &LayoutSearch::indexChanged, this, &LayoutFilterModel::queueRefresh);
+}
+
+void LayoutFilterModel::setQuery(const QString &text)
+{
+    const QString trimmed = text.trimmed();
+    QHash<QString, int> found;
+    if (!trimmed.isEmpty())
+        found = LayoutSearch::instance().search(trimmed);
+
+    const bool wasFiltered = !query.isEmpty();
+    const bool filtered = !trimmed.isEmpty();
+    if (!wasFiltered && !filtered)
+        return;
+
+    // Rows that stay shown keep their order unless their scores moved by
+    // different amounts; an unfiltered row scores 0
+    int kept = 0;
+    bool haveShift = false;
+    int shift = 0;
+    bool orderChanged = false;
+    auto keep = [&](int before, int after) {
+        ++kept;
+        if (!haveShift) {
+            haveShift = true;
+            shift = after - before;
+        } else if (after - before != shift) {
+            orderChanged = true;
+        }
+    };
+    if (filtered) {
+        for (auto it = found.cbegin(); it != found.cend(); ++it) {
+            auto previous = scores.constFind(it.key());
+            if (previous != scores.cend())
+                keep(previous.value(), it.value());
+            else if (!wasFiltered)
+                keep(0, it.value());
+        }
+    } else {
+        for (auto it = scores.cbegin(); it != scores.cend(); ++it)
+            keep(it.value(), 0);
+    }
+    const bool rowsChanged = wasFiltered != filtered || kept != found.size() || kept != scores.size();
+
+    query = trimmed;
+    scores = found;
+    if (orderChanged)
+        invalidate();
+    else if (rowsChanged)
+        invalidateFilter();
+}
+
+void LayoutFilterModel::queueRefresh()
+{
+    // Without a query every row is shown and the source keeps it current
+    if (query.isEmpty() || refreshQueued)
+        return;
+
+    refreshQueued = true;
+    QTimer::singleShot(0, this, [this]() {
+        refreshQueued = false;
+        setQuery(query);
+    });
+}
+
+bool LayoutFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &) const
+{
+    if (query.isEmpty())
+        return true;
+
+    return scores.contains(static_cast<const LayoutListModel *>(sourceModel())->layoutName(sourceRow));
+}
+
+bool LayoutFilterModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+    const LayoutListModel *model = static_cast<const LayoutListModel *>(sourceModel());
+    const QString &leftName = model->layoutName(left.row());
+    const QString &rightName = model->layoutName(right.row());
+
+    if (!scores.isEmpty()) {
+        const int leftScore = scores.value(leftName);
+        const int rightScore = scores.value(rightName);
+        if (leftScore != rightScore)
+            return leftScore > rightScore;
+    }
+
+    // Unused layouts (-1) after all used ones
+    const uint leftRank = uint(model->recentRank(left.row()));
+    const uint rightRank = uint(model->recentRank(right.row()));
+    if (leftRank != rightRank)
+        return leftRank < rightRank;
+
+    return leftName < rightName;
+}
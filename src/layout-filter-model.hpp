@@ -0,0 +1,37 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QSortFilterProxyModel>
+#include <QString>
+
+// Orders and filters LayoutListModel rows for the dialog.
+//
+// Matches come from LayoutSearch, once per query, so filtering a row is a
+// single hash lookup. Rows are ranked by match score, then by how recently
+// the layout was used, then by name. The source must be a LayoutListModel;
+// its rank role is the sort role, so a layout being used only moves the rows
+// whose rank changed.
+class LayoutFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit LayoutFilterModel(QObject *parent = nullptr);
+
+    void setQuery(const QString &query);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
+
+private:
+    void queueRefresh();
+
+    QString query;
+    QHash<QString, int> scores;
+    bool refreshQueued = false;
+};
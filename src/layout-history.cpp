@@ -0,0 +1,316 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-history.hpp"
+#include "layout-store.hpp"
+#include "restore-scheduler.hpp"
+
+#include <QChildEvent>
+#include <QDockWidget>
+
+static const QString memoryLimitSettingKey = QStringLiteral("HistoryMemoryKb");
+static const QString undoBindingsSettingKey = QStringLiteral("HistoryUndoHotkey");
+static const QString redoBindingsSettingKey = QStringLiteral("HistoryRedoHotkey");
+
+// Quiet time after the last dock event before a snapshot is taken
+static constexpr int captureDelayMs = 1000;
+
+// Quiet time after an undo or redo before events count as changes again
+static constexpr int settleDelayMs = 500;
+
+// Bounds the work of rebuilding a snapshot from its deltas
+static constexpr int keyframeInterval = 16;
+
+static QString bindings_json(obs_hotkey_id id)
+{
+    obs_data_array_t *bindings = obs_hotkey_save(id);
+    obs_data_t *data = obs_data_create();
+    obs_data_set_array(data, "bindings", bindings);
+    QString json = QString::fromUtf8(obs_data_get_json(data));
+    obs_data_release(data);
+    obs_data_array_release(bindings);
+    return json;
+}
+
+static void load_bindings(obs_hotkey_id id, const QString &json)
+{
+    if (json.isEmpty())
+        return;
+
+    obs_data_t *data = obs_data_create_from_json(json.toUtf8().constData());
+    if (!data)
+        return;
+    obs_data_array_t *bindings = obs_data_get_array(data, "bindings");
+    obs_hotkey_load(id, bindings);
+    obs_data_array_release(bindings);
+    obs_data_release(data);
+}
+
+LayoutHistory &LayoutHistory::instance()
+{
+    static LayoutHistory history;
+    return history;
+}
+
+int LayoutHistory::memoryLimitSettingKb()
+{
+    bool ok;
+    int limitKb = LayoutStore::instance().setting(memoryLimitSettingKey).toInt(&ok);
+    return ok && limitKb > 0 ? limitKb : defaultMemoryLimitKb;
+}
+
+LayoutHistory::LayoutHistory()
+{
+    captureTimer.setSingleShot(true);
+    captureTimer.setInterval(captureDelayMs);
+    connect(&captureTimer, &QTimer::timeout, this, &LayoutHistory::capture);
+
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(settleDelayMs);
+    connect(&settleTimer, &QTimer::timeout, this, [this]() { settling = false; });
+}
+
+void LayoutHistory::registerHotkeys()
+{
+    if (undoHotkey != OBS_INVALID_HOTKEY_ID)
+        return;
+
+    LayoutStore &store = LayoutStore::instance();
+    undoHotkey = obs_hotkey_register_frontend("DockLayoutManager.Undo", "Undo dock layout change", undoPressed, this);
+    redoHotkey = obs_hotkey_register_frontend("DockLayoutManager.Redo", "Redo dock layout change", redoPressed, this);
+    load_bindings(undoHotkey, store.setting(undoBindingsSettingKey));
+    load_bindings(redoHotkey, store.setting(redoBindingsSettingKey));
+}
+
+void LayoutHistory::saveBindings()
+{
+    if (undoHotkey == OBS_INVALID_HOTKEY_ID)
+        return;
+
+    LayoutStore &store = LayoutStore::instance();
+    store.setSetting(undoBindingsSettingKey, bindings_json(undoHotkey));
+    store.setSetting(redoBindingsSettingKey, bindings_json(redoHotkey));
+}
+
+void LayoutHistory::unregisterHotkeys()
+{
+    if (undoHotkey == OBS_INVALID_HOTKEY_ID)
+        return;
+
+    obs_hotkey_unregister(undoHotkey);
+    obs_hotkey_unregister(redoHotkey);
+    undoHotkey = redoHotkey = OBS_INVALID_HOTKEY_ID;
+    captureTimer.stop();
+}
+
+void LayoutHistory::start(QMainWindow *window)
+{
+    if (mainWindow)
+        return;
+
+    mainWindow = window;
+    memoryLimitBytes = qint64(memoryLimitSettingKb()) * 1024;
+
+    // Docks of plugins that load later are picked up as they are polished
+    mainWindow->installEventFilter(this);
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>())
+        watchDock(dock);
+
+    // A layout switch also ends an undo step it superseded
+    if (RestoreScheduler *scheduler = RestoreScheduler::instance()) {
+        connect(scheduler, &RestoreScheduler::finished, this, &LayoutHistory::onSwitchFinished);
+        connect(scheduler, &RestoreScheduler::snapshotApplied, this, &LayoutHistory::onSwitchFinished);
+    }
+
+    // The arrangement to go back to first
+    captureTimer.start();
+}
+
+void LayoutHistory::setMemoryLimitKb(int limitKb)
+{
+    memoryLimitBytes = qint64(limitKb) * 1024;
+    LayoutStore::instance().setSetting(memoryLimitSettingKey, QString::number(limitKb));
+    enforceMemoryLimit();
+}
+
+void LayoutHistory::undo()
+{
+    // Changes still waiting for the timer can be redone afterwards
+    if (captureTimer.isActive()) {
+        captureTimer.stop();
+        capture();
+    }
+
+    if (canUndo())
+        applyEntry(position - 1);
+}
+
+void LayoutHistory::redo()
+{
+    // A change made after undoing replaces what could be redone
+    if (captureTimer.isActive()) {
+        captureTimer.stop();
+        capture();
+    }
+
+    if (canRedo())
+        applyEntry(position + 1);
+}
+
+bool LayoutHistory::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == mainWindow) {
+        if (event->type() == QEvent::ChildPolished)
+            watchDock(static_cast<QChildEvent *>(event)->child());
+        return false;
+    }
+
+    switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Hide:
+        if (settling)
+            settleTimer.start();
+        else if (!applying)
+            captureTimer.start();
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+void LayoutHistory::watchDock(QObject *object)
+{
+    // Installing twice keeps a single filter
+    if (qobject_cast<QDockWidget *>(object))
+        object->installEventFilter(this);
+}
+
+void LayoutHistory::capture()
+{
+    if (!mainWindow || applying || settling)
+        return;
+
+    // A switch in progress is captured once it is done
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    if (scheduler && scheduler->isRunning()) {
+        captureTimer.start();
+        return;
+    }
+
+    append(mainWindow->saveState());
+}
+
+void LayoutHistory::append(const QByteArray &state)
+{
+    if (state.isEmpty() || (position >= 0 && state == shownState))
+        return;
+
+    // A new change discards what could have been redone
+    while (entries.size() > position + 1) {
+        memoryBytes -= entries.last().bytes.size();
+        entries.removeLast();
+    }
+
+    int sinceKeyframe = 0;
+    for (int index = int(entries.size()) - 1; index >= 0 && !entries[index].keyframe; --index)
+        ++sinceKeyframe;
+
+    Entry entry;
+    if (entries.isEmpty() || sinceKeyframe + 1 >= keyframeInterval) {
+        entry.keyframe = true;
+        entry.bytes = state;
+    } else {
+        // Dragging one splitter only changes a few bytes in the middle
+        const int shared = int(qMin(state.size(), shownState.size()));
+        while (entry.prefix < shared && state[entry.prefix] == shownState[entry.prefix])
+            ++entry.prefix;
+        while (entry.suffix < shared - entry.prefix &&
+               state[state.size() - 1 - entry.suffix] == shownState[shownState.size() - 1 - entry.suffix])
+            ++entry.suffix;
+        entry.bytes = state.mid(entry.prefix, state.size() - entry.prefix - entry.suffix);
+    }
+
+    memoryBytes += entry.bytes.size();
+    entries.append(entry);
+    position = int(entries.size()) - 1;
+    shownState = state;
+
+    enforceMemoryLimit();
+}
+
+QByteArray LayoutHistory::reconstruct(int index) const
+{
+    int start = index;
+    while (start > 0 && !entries[start].keyframe)
+        --start;
+
+    QByteArray state = entries[start].bytes;
+    for (int next = start + 1; next <= index; ++next) {
+        const Entry &entry = entries[next];
+        state = state.left(entry.prefix) + entry.bytes + state.right(entry.suffix);
+    }
+    return state;
+}
+
+void LayoutHistory::enforceMemoryLimit()
+{
+    // The shown entry always stays
+    while (memoryBytes > memoryLimitBytes && position > 0) {
+        // The second entry becomes the oldest, so it needs its full state
+        Entry &second = entries[1];
+        if (!second.keyframe) {
+            QByteArray full = reconstruct(1);
+            memoryBytes += full.size() - second.bytes.size();
+            second.bytes = full;
+            second.keyframe = true;
+            second.prefix = second.suffix = 0;
+        }
+
+        memoryBytes -= entries.first().bytes.size();
+        entries.removeFirst();
+        --position;
+    }
+}
+
+void LayoutHistory::applyEntry(int index)
+{
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    if (!scheduler)
+        return;
+
+    position = index;
+    shownState = reconstruct(index);
+
+    captureTimer.stop();
+    applying = true;
+
+    // Still the same layout, only its docks move
+    scheduler->applySnapshot(shownState);
+}
+
+void LayoutHistory::onSwitchFinished()
+{
+    if (!applying)
+        return;
+
+    // The relayout after the switch arrives as more dock events
+    applying = false;
+    settling = true;
+    settleTimer.start();
+}
+
+void LayoutHistory::undoPressed(void *data, obs_hotkey_id, obs_hotkey_t *, bool pressed)
+{
+    if (pressed)
+        QMetaObject::invokeMethod(static_cast<LayoutHistory *>(data), &LayoutHistory::undo, Qt::QueuedConnection);
+}
+
+void LayoutHistory::redoPressed(void *data, obs_hotkey_id, obs_hotkey_t *, bool pressed)
+{
+    if (pressed)
+        QMetaObject::invokeMethod(static_cast<LayoutHistory *>(data), &LayoutHistory::redo, Qt::QueuedConnection);
+}
@@ -0,0 +1,88 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <obs-module.h>
+
+#include <QByteArray>
+#include <QMainWindow>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+// Undo history of the dock arrangement, captured automatically.
+//
+// Moving, resizing, floating, showing or hiding a dock restarts a debounce
+// timer; once things settle the main window state is captured. Snapshots are
+// kept in memory only, each stored as the bytes that differ from the one
+// before it, with a full snapshot every few entries. The oldest entries are
+// dropped once the history uses more than the HistoryMemoryKb setting.
+// Undo and redo are OBS hotkeys and go through the restore scheduler as
+// snapshots, which leave the current layout as it is.
+class LayoutHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int defaultMemoryLimitKb = 512;
+
+    static LayoutHistory &instance();
+    static int memoryLimitSettingKb();
+
+    void registerHotkeys();
+    void saveBindings();
+    void unregisterHotkeys();
+
+    // Starts watching the docks of the main window
+    void start(QMainWindow *mainWindow);
+
+    void setMemoryLimitKb(int limitKb);
+
+    bool canUndo() const { return position > 0; }
+    bool canRedo() const { return position + 1 < entries.size(); }
+    void undo();
+    void redo();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Entry {
+        bool keyframe = false;
+        int prefix = 0;   // Bytes shared with the start of the previous state
+        int suffix = 0;   // Bytes shared with the end of the previous state
+        QByteArray bytes; // The whole state for keyframes, else what differs
+    };
+
+    LayoutHistory();
+
+    void watchDock(QObject *object);
+    void capture();
+    void append(const QByteArray &state);
+    QByteArray reconstruct(int index) const;
+    void enforceMemoryLimit();
+    void applyEntry(int index);
+    void onSwitchFinished();
+
+    static void undoPressed(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+    static void redoPressed(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+
+    QPointer<QMainWindow> mainWindow;
+    QTimer captureTimer;
+    QTimer settleTimer;
+
+    QVector<Entry> entries;
+    int position = -1;     // Entry the window shows
+    QByteArray shownState; // Reconstructed entries[position]
+    qint64 memoryBytes = 0;
+    qint64 memoryLimitBytes = qint64(defaultMemoryLimitKb) * 1024;
+
+    bool applying = false; // An undo or redo is being switched to
+    bool settling = false; // Events caused by that switch are ignored
+
+    obs_hotkey_id undoHotkey = OBS_INVALID_HOTKEY_ID;
+    obs_hotkey_id redoHotkey = OBS_INVALID_HOTKEY_ID;
+};
@@ -0,0 +1,260 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-hotkeys.hpp"
+#include "layout-store.hpp"
+#include "partial-layout.hpp"
+#include "restore-scheduler.hpp"
+#include "screen-config.hpp"
+
+#include <util/platform.h>
+
+static const QString hotkeyKey = QStringLiteral("Hotkey");
+
+static QByteArray bindings_to_json(obs_data_array_t *bindings)
+{
+    obs_data_t *data = obs_data_create();
+    obs_data_set_array(data, "bindings", bindings);
+    QByteArray json(obs_data_get_json(data));
+    obs_data_release(data);
+    return json;
+}
+
+static QByteArray hotkey_name(const QString &layoutName)
+{
+    return QStringLiteral("DockLayoutManager.Layout.%1").arg(layoutName).toUtf8();
+}
+
+// Variant for the current screens, so a keypress needs no lookup
+static QByteArray preload_state(const QString &layoutName)
+{
+    return LayoutStore::instance().windowState(layoutName, ScreenConfig::instance().currentKey());
+}
+
+LayoutHotkeys &LayoutHotkeys::instance()
+{
+    static LayoutHotkeys hotkeys;
+    return hotkeys;
+}
+
+void LayoutHotkeys::registerAll()
+{
+    LayoutStore &store = LayoutStore::instance();
+    for (const QString &name : store.layoutNames())
+        registerLayout(name, store.value(name, hotkeyKey));
+
+    if (following)
+        return;
+    following = true;
+
+    connect(&store, &LayoutStore::layoutAdded, this,
+            [this](const QString &name) { registerLayout(name, QByteArray()); });
+    connect(&store, &LayoutStore::layoutChanged, this, [this](const QString &name) {
+        if (preloadedStates.contains(name))
+            preloadedStates.insert(name, preload_state(name));
+    });
+    connect(&ScreenConfig::instance(), &ScreenConfig::changed, this, [this]() {
+        for (auto it = preloadedStates.begin(); it != preloadedStates.end(); ++it)
+            it.value() = preload_state(it.key());
+    });
+    connect(&store, &LayoutStore::layoutsReset, this, [this](const QStringList &names) {
+        // Imported layouts bring their bindings along
+        LayoutStore &layouts = LayoutStore::instance();
+        for (const QString &name : names) {
+            if (!idsByName.contains(name))
+                registerLayout(name, layouts.value(name, hotkeyKey));
+            else if (preloadedStates.contains(name))
+                preloadedStates.insert(name, preload_state(name));
+        }
+    });
+    connect(&store, &LayoutStore::layoutRemoved, this, &LayoutHotkeys::unregisterLayout);
+    connect(&store, &LayoutStore::layoutRenamed, this, &LayoutHotkeys::onLayoutRenamed);
+
+    // Keys bound in the settings dialog start preloading right away
+    signal_handler_connect(obs_get_signal_handler(), "hotkey_bindings_changed", bindingsChanged, this);
+}
+
+void LayoutHotkeys::registerLayout(const QString &name, const QByteArray &bindings)
+{
+    if (idsByName.contains(name))
+        return;
+
+    const QByteArray description = QStringLiteral("Switch to dock layout '%1'").arg(name).toUtf8();
+    obs_hotkey_id id = obs_hotkey_register_frontend(hotkey_name(name).constData(), description.constData(),
+                                                    hotkeyPressed, nullptr);
+    if (id == OBS_INVALID_HOTKEY_ID) {
+        blog(LOG_WARNING, "Failed to register hotkey for dock layout '%s'", name.toUtf8().constData());
+        return;
+    }
+
+    bool bound = false;
+    if (!bindings.isEmpty()) {
+        obs_data_t *data = obs_data_create_from_json(bindings.constData());
+        if (data) {
+            obs_data_array_t *array = obs_data_get_array(data, "bindings");
+            obs_hotkey_load(id, array);
+            bound = obs_data_array_count(array) > 0;
+            obs_data_array_release(array);
+            obs_data_release(data);
+        }
+    }
+
+    idsByName.insert(name, id);
+    if (bound)
+        preloadedStates.insert(name, preload_state(name));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    namesById.insert(id, name);
+}
+
+void LayoutHotkeys::unregisterLayout(const QString &name)
+{
+    auto it = idsByName.find(name);
+    if (it == idsByName.end())
+        return;
+
+    const obs_hotkey_id id = *it;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        namesById.remove(id);
+    }
+    obs_hotkey_unregister(id);
+
+    idsByName.erase(it);
+    preloadedStates.remove(name);
+}
+
+void LayoutHotkeys::onLayoutRenamed(const QString &oldName, const QString &newName)
+{
+    // The hotkey name contains the layout name, so move the bindings over
+    QByteArray bindings;
+    auto it = idsByName.constFind(oldName);
+    if (it != idsByName.constEnd()) {
+        obs_data_array_t *array = obs_hotkey_save(*it);
+        bindings = bindings_to_json(array);
+        obs_data_array_release(array);
+        LayoutStore::instance().setValue(newName, hotkeyKey, bindings);
+    }
+
+    unregisterLayout(oldName);
+    registerLayout(newName, bindings);
+}
+
+void LayoutHotkeys::onBindingsChanged(obs_hotkey_id id)
+{
+    QString name;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        name = namesById.value(id);
+    }
+    if (name.isEmpty())
+        return;
+
+    obs_data_array_t *array = obs_hotkey_save(id);
+    const bool bound = obs_data_array_count(array) > 0;
+    obs_data_array_release(array);
+
+    // Loading the saved bindings lands here too, already preloaded
+    if (!bound)
+        preloadedStates.remove(name);
+    else if (!preloadedStates.contains(name))
+        preloadedStates.insert(name, preload_state(name));
+}
+
+void LayoutHotkeys::saveBindings()
+{
+    LayoutStore &store = LayoutStore::instance();
+    for (auto it = idsByName.constBegin(); it != idsByName.constEnd(); ++it) {
+        obs_data_array_t *array = obs_hotkey_save(it.value());
+        QByteArray bindings = bindings_to_json(array);
+        obs_data_array_release(array);
+
+        // Unchanged bindings do not need a write
+        if (store.value(it.key(), hotkeyKey) != bindings)
+            store.setValue(it.key(), hotkeyKey, bindings);
+    }
+}
+
+void LayoutHotkeys::unregisterAll()
+{
+    signal_handler_disconnect(obs_get_signal_handler(), "hotkey_bindings_changed", bindingsChanged, this);
+
+    const QStringList names = idsByName.keys();
+    for (const QString &name : names)
+        unregisterLayout(name);
+}
+
+void LayoutHotkeys::hotkeyPressed(void *, obs_hotkey_id id, obs_hotkey_t *, bool pressed)
+{
+    if (!pressed)
+        return;
+
+    const uint64_t pressedNs = os_gettime_ns();
+    LayoutHotkeys &hotkeys = instance();
+
+    QString name;
+    {
+        std::lock_guard<std::mutex> lock(hotkeys.mutex);
+        name = hotkeys.namesById.value(id);
+    }
+    if (name.isEmpty())
+        return;
+
+    QMetaObject::invokeMethod(
+        &hotkeys, [&hotkeys, name, pressedNs]() { hotkeys.switchTo(name, pressedNs); }, Qt::QueuedConnection);
+}
+
+void LayoutHotkeys::bindingsChanged(void *data, calldata_t *params)
+{
+    auto *hotkeys = static_cast<LayoutHotkeys *>(data);
+    const obs_hotkey_id id = obs_hotkey_get_id(static_cast<obs_hotkey_t *>(calldata_ptr(params, "key")));
+    {
+        std::lock_guard<std::mutex> lock(hotkeys->mutex);
+        if (!hotkeys->namesById.contains(id))
+            return;
+    }
+
+    // Emitted with the hotkey lock held, so read the bindings later
+    QMetaObject::invokeMethod(
+        hotkeys, [hotkeys, id]() { hotkeys->onBindingsChanged(id); }, Qt::QueuedConnection);
+}
+
+void LayoutHotkeys::switchTo(const QString &name, uint64_t pressedNs)
+{
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    if (scheduler && PartialLayout::isPartial(name)) {
+        connect(scheduler, &RestoreScheduler::finished, this, &LayoutHotkeys::onSwitchFinished, Qt::UniqueConnection);
+        pendingName = name;
+        pendingPressedNs = pressedNs;
+        PartialLayout::apply({name});
+        return;
+    }
+
+    // A key bound since the last check is not preloaded yet
+    QByteArray state = preloadedStates.value(name);
+    if (state.isEmpty())
+        state = preload_state(name);
+    if (!scheduler || state.isEmpty()) {
+        blog(LOG_WARNING, "Dock layout '%s' cannot be applied from its hotkey", name.toUtf8().constData());
+        return;
+    }
+
+    connect(scheduler, &RestoreScheduler::finished, this, &LayoutHotkeys::onSwitchFinished, Qt::UniqueConnection);
+
+    pendingName = name;
+    pendingPressedNs = pressedNs;
+    scheduler->switchTo(name, state);
+}
+
+void LayoutHotkeys::onSwitchFinished(const QString &name, bool ok)
+{
+    if (name != pendingName)
+        return;
+
+    if (ok) {
+        blog(LOG_INFO, "Hotkey switch to dock layout '%s' completed %.2f ms after the keypress",
+             name.toUtf8().constData(), (os_gettime_ns() - pendingPressedNs) / 1e6);
+    }
+    pendingName.clear();
+}
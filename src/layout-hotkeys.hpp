@@ -0,0 +1,62 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <obs-module.h>
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+#include <cstdint>
+#include <mutex>
+
+// Gives every layout an OBS frontend hotkey that switches to it.
+//
+// Bindings are stored with the layout (as the "Hotkey" value). The target
+// states of layouts with a bound key are kept decoded in memory, so their
+// keypress goes straight to the restore scheduler without touching the
+// store; most layouts have no binding and are not loaded at all.
+class LayoutHotkeys : public QObject
+{
+    Q_OBJECT
+
+public:
+    static LayoutHotkeys &instance();
+
+    // Registers a hotkey per layout and follows the store from then on
+    void registerAll();
+
+    // Writes each hotkey's current bindings into its layout
+    void saveBindings();
+
+    void unregisterAll();
+
+private:
+    LayoutHotkeys() = default;
+
+    void registerLayout(const QString &name, const QByteArray &bindings);
+    void unregisterLayout(const QString &name);
+    void onLayoutRenamed(const QString &oldName, const QString &newName);
+    void onBindingsChanged(obs_hotkey_id id);
+    void onSwitchFinished(const QString &name, bool ok);
+    void switchTo(const QString &name, uint64_t pressedNs);
+
+    static void hotkeyPressed(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+    static void bindingsChanged(void *data, calldata_t *params);
+
+    bool following = false;
+    QHash<QString, obs_hotkey_id> idsByName;
+    QHash<QString, QByteArray> preloadedStates; // Layouts with a bound key
+
+    // Pending hotkey switch, for the latency log line
+    QString pendingName;
+    uint64_t pendingPressedNs = 0;
+
+    // Hotkey callbacks run on the OBS hotkey thread
+    std::mutex mutex;
+    QHash<obs_hotkey_id, QString> namesById;
+};
@@ -0,0 +1,226 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-list-model.hpp"
+
+#include "dock-index.hpp"
+#include "layout-search.hpp"
+#include "layout-store.hpp"
+#include "layout-thumbnails.hpp"
+
+#include <QFont>
+
+#include <algorithm>
+
+LayoutListModel::LayoutListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    LayoutStore &store = LayoutStore::instance();
+    names = store.layoutNames();
+    defaultName = store.defaultLayout();
+    loadRanks();
+
+    connect(&store, &LayoutStore::layoutAdded, this, &LayoutListModel::onLayoutAdded);
+    connect(&store, &LayoutStore::layoutChanged, this, [this](const QString &name) { emitRowChanged(name); });
+    connect(&store, &LayoutStore::layoutRemoved, this, &LayoutListModel::onLayoutRemoved);
+    connect(&store, &LayoutStore::layoutRenamed, this, &LayoutListModel::onLayoutRenamed);
+    connect(&store, &LayoutStore::layoutsReset, this, &LayoutListModel::onLayoutsReset);
+    connect(&store, &LayoutStore::defaultLayoutChanged, this, &LayoutListModel::onDefaultLayoutChanged);
+
+    connect(&LayoutSearch::instance(), &LayoutSearch::recentChanged, this, &LayoutListModel::onRecentChanged);
+
+    // Naming the roles keeps sorting proxies from looking at the row again
+    connect(&DockIndex::instance(), &DockIndex::compatibilityChanged, this,
+            [this](const QString &name) { emitRowChanged(name, {Qt::FontRole, Qt::ToolTipRole}); });
+
+    LayoutThumbnails &thumbnails = LayoutThumbnails::instance();
+    connect(&thumbnails, &LayoutThumbnails::thumbnailReady, this,
+            [this](const QString &name) { emitRowChanged(name, {Qt::DecorationRole}); });
+    connect(&thumbnails, &LayoutThumbnails::thumbnailsInvalidated, this, [this]() {
+        if (!names.isEmpty())
+            emit dataChanged(index(0), index(int(names.size()) - 1), {Qt::DecorationRole});
+    });
+}
+
+int LayoutListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(names.size());
+}
+
+QVariant LayoutListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= names.size()) {
+        return QVariant();
+    }
+
+    const QString &name = names.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return name;
+    case Qt::DecorationRole:
+        // Views only ask for the rows they paint, so only those get rendered
+        return LayoutThumbnails::instance().thumbnail(name);
+    case Qt::FontRole:
+        if (name == defaultName || !DockIndex::instance().isComplete(name)) {
+            // Bold indicates the default layout, italics one with missing docks
+            QFont font;
+            font.setBold(name == defaultName);
+            font.setItalic(!DockIndex::instance().isComplete(name));
+            return font;
+        }
+        break;
+    case Qt::ToolTipRole: {
+        QStringList lines;
+        if (name == defaultName) {
+            lines.append(QString("Default layout"));
+        }
+        QStringList tags = LayoutSearch::instance().tags(name);
+        if (!tags.isEmpty()) {
+            lines.append(QString("Tags: %1").arg(tags.join(", ")));
+        }
+        QStringList missing = DockIndex::instance().missingDocks(name);
+        if (!missing.isEmpty()) {
+            lines.append(QString("Restored without docks that do not exist: %1").arg(missing.join(", ")));
+        }
+        if (!lines.isEmpty()) {
+            return lines.join("\n");
+        }
+        break;
+    }
+    case RecentRankRole:
+        return ranks.at(index.row());
+    }
+    return QVariant();
+}
+
+QString LayoutListModel::layoutName(const QModelIndex &index) const
+{
+    return index.isValid() && index.row() < names.size() ? names.at(index.row()) : QString();
+}
+
+QModelIndex LayoutListModel::indexOf(const QString &name) const
+{
+    int row = lowerBound(name);
+    return row < names.size() && names.at(row) == name ? index(row) : QModelIndex();
+}
+
+int LayoutListModel::lowerBound(const QString &name) const
+{
+    return int(std::lower_bound(names.cbegin(), names.cend(), name) - names.cbegin());
+}
+
+void LayoutListModel::emitRowChanged(const QString &name, const QVector<int> &roles)
+{
+    QModelIndex changed = indexOf(name);
+    if (changed.isValid()) {
+        emit dataChanged(changed, changed, roles);
+    }
+}
+
+void LayoutListModel::loadRanks()
+{
+    const LayoutSearch &search = LayoutSearch::instance();
+    ranks.clear();
+    ranks.reserve(names.size());
+    for (const QString &name : names) {
+        ranks.append(search.recentRank(name));
+    }
+}
+
+void LayoutListModel::onLayoutAdded(const QString &name)
+{
+    int row = lowerBound(name);
+    if (row < names.size() && names.at(row) == name) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), row, row);
+    names.insert(row, name);
+    ranks.insert(row, LayoutSearch::instance().recentRank(name));
+    endInsertRows();
+}
+
+void LayoutListModel::onLayoutRemoved(const QString &name)
+{
+    QModelIndex removed = indexOf(name);
+    if (!removed.isValid()) {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), removed.row(), removed.row());
+    names.removeAt(removed.row());
+    ranks.removeAt(removed.row());
+    endRemoveRows();
+}
+
+void LayoutListModel::onLayoutsReset()
+{
+    LayoutStore &store = LayoutStore::instance();
+    beginResetModel();
+    names = store.layoutNames();
+    defaultName = store.defaultLayout();
+    loadRanks();
+    endResetModel();
+}
+
+void LayoutListModel::onLayoutRenamed(const QString &oldName, const QString &newName)
+{
+    QModelIndex renamed = indexOf(oldName);
+    if (!renamed.isValid() || indexOf(newName).isValid()) {
+        return;
+    }
+
+    int from = renamed.row();
+    int to = lowerBound(newName); // Insertion point while oldName is still in the list
+
+    // LayoutSearch may follow the rename before or after this model, and
+    // reports the new rank then
+    const int rank = LayoutSearch::instance().recentRank(newName);
+
+    if (to == from || to == from + 1) {
+        // Sorts into the same row
+        names[from] = newName;
+        ranks[from] = rank;
+        emit dataChanged(renamed, renamed);
+        return;
+    }
+
+    // A move keeps the selection on the renamed row
+    beginMoveRows(QModelIndex(), from, from, QModelIndex(), to);
+    names.removeAt(from);
+    ranks.removeAt(from);
+    names.insert(to > from ? to - 1 : to, newName);
+    ranks.insert(to > from ? to - 1 : to, rank);
+    endMoveRows();
+
+    emitRowChanged(newName);
+}
+
+void LayoutListModel::onDefaultLayoutChanged(const QString &name)
+{
+    QString previous = defaultName;
+    defaultName = name;
+
+    emitRowChanged(previous, {Qt::FontRole, Qt::ToolTipRole});
+    emitRowChanged(name, {Qt::FontRole, Qt::ToolTipRole});
+}
+
+void LayoutListModel::onRecentChanged(const QStringList &changed)
+{
+    const LayoutSearch &search = LayoutSearch::instance();
+    for (const QString &name : changed) {
+        QModelIndex row = indexOf(name);
+        if (!row.isValid()) {
+            continue;
+        }
+
+        const int rank = search.recentRank(name);
+        if (ranks.at(row.row()) != rank) {
+            ranks[row.row()] = rank;
+            emit dataChanged(row, row, {RecentRankRole});
+        }
+    }
+}
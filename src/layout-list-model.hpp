@@ -0,0 +1,58 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Layout names for the dialog's list view, kept sorted and in step with
+// LayoutStore through its signals.
+//
+// Every store change becomes a single row insert, remove, move or update, so
+// the view only relayouts and repaints the rows that are affected. A batch
+// of imported layouts becomes a single model reset. Rows are
+// decorated with LayoutThumbnails, which are rendered as rows come into view,
+// and carry their recently used rank, updated only for the layouts whose
+// rank changed.
+class LayoutListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Role {
+        RecentRankRole = Qt::UserRole + 1, // LayoutSearch::recentRank() of the row
+    };
+
+    explicit LayoutListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    QString layoutName(const QModelIndex &index) const;
+    QModelIndex indexOf(const QString &name) const;
+
+    // For proxies comparing many rows, without going through QVariant
+    const QString &layoutName(int row) const { return names.at(row); }
+    int recentRank(int row) const { return ranks.at(row); }
+
+private:
+    // Row of name, or where it would be inserted
+    int lowerBound(const QString &name) const;
+    void emitRowChanged(const QString &name, const QVector<int> &roles = QVector<int>());
+    void loadRanks();
+
+    void onLayoutAdded(const QString &name);
+    void onLayoutRemoved(const QString &name);
+    void onLayoutsReset();
+    void onLayoutRenamed(const QString &oldName, const QString &newName);
+    void onDefaultLayoutChanged(const QString &name);
+    void onRecentChanged(const QStringList &changed);
+
+    QStringList names; // Same order as LayoutStore::layoutNames()
+    QVector<int> ranks; // Recently used rank of each row, -1 if unused
+    QString defaultName;
+};
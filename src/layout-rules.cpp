@@ -0,0 +1,322 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-rules.hpp"
+#include "layout-store.hpp"
+#include "partial-layout.hpp"
+#include "restore-scheduler.hpp"
+#include "screen-config.hpp"
+
+#include <obs-module.h>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+static const QString rulesSettingKey = QStringLiteral("AutoSwitchRules");
+static const QString debounceSettingKey = QStringLiteral("AutoSwitchDebounceMs");
+
+static QString current_scene_name()
+{
+    obs_source_t *scene = obs_frontend_get_current_scene();
+    if (!scene)
+        return QString();
+    QString name = QString::fromUtf8(obs_source_get_name(scene));
+    obs_source_release(scene);
+    return name;
+}
+
+// Frontend getters that hand out a bmalloc'd string
+static QString take_string(char *value)
+{
+    QString result = QString::fromUtf8(value);
+    bfree(value);
+    return result;
+}
+
+static bool is_wildcard(const QString &pattern)
+{
+    return pattern.contains(QLatin1Char('*')) || pattern.contains(QLatin1Char('?')) ||
+           pattern.contains(QLatin1Char('['));
+}
+
+LayoutRules &LayoutRules::instance()
+{
+    static LayoutRules rules;
+    return rules;
+}
+
+LayoutRules::LayoutRules()
+{
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(defaultDebounceMs);
+    connect(&debounceTimer, &QTimer::timeout, this, &LayoutRules::applyPending);
+}
+
+const char *LayoutRules::triggerId(Trigger trigger)
+{
+    switch (trigger) {
+    case Trigger::SceneChanged:
+        return "scene";
+    case Trigger::ProfileChanged:
+        return "profile";
+    case Trigger::SceneCollectionChanged:
+        return "scene_collection";
+    case Trigger::StreamingStarted:
+        return "streaming";
+    case Trigger::RecordingStarted:
+        return "recording";
+    }
+    return "";
+}
+
+QString LayoutRules::triggerLabel(Trigger trigger)
+{
+    switch (trigger) {
+    case Trigger::SceneChanged:
+        return QStringLiteral("Scene changed");
+    case Trigger::ProfileChanged:
+        return QStringLiteral("Profile changed");
+    case Trigger::SceneCollectionChanged:
+        return QStringLiteral("Scene collection changed");
+    case Trigger::StreamingStarted:
+        return QStringLiteral("Streaming started");
+    case Trigger::RecordingStarted:
+        return QStringLiteral("Recording started");
+    }
+    return QString();
+}
+
+bool LayoutRules::triggerHasName(Trigger trigger)
+{
+    return trigger == Trigger::SceneChanged || trigger == Trigger::ProfileChanged ||
+           trigger == Trigger::SceneCollectionChanged;
+}
+
+void LayoutRules::start()
+{
+    load();
+    active = true;
+
+    if (following)
+        return;
+    following = true;
+
+    connect(&LayoutStore::instance(), &LayoutStore::layoutRenamed, this, &LayoutRules::onLayoutRenamed);
+}
+
+void LayoutRules::stop()
+{
+    active = false;
+    debounceTimer.stop();
+    pendingLayout.clear();
+}
+
+void LayoutRules::load()
+{
+    LayoutStore &store = LayoutStore::instance();
+
+    bool ok;
+    int milliseconds = store.setting(debounceSettingKey).toInt(&ok);
+    debounceTimer.setInterval(ok && milliseconds >= 0 ? milliseconds : defaultDebounceMs);
+
+    ruleList.clear();
+    const QJsonObject root = QJsonDocument::fromJson(store.setting(rulesSettingKey).toUtf8()).object();
+    const QJsonArray array = root.value(QStringLiteral("rules")).toArray();
+    for (const QJsonValue &entry : array) {
+        const QJsonObject object = entry.toObject();
+        const QByteArray id = object["event"].toString().toUtf8();
+
+        Rule rule;
+        bool known = false;
+        for (int index = 0; index < triggerCount && !known; ++index) {
+            if (id == triggerId(Trigger(index))) {
+                rule.trigger = Trigger(index);
+                known = true;
+            }
+        }
+        rule.pattern = object["pattern"].toString();
+        rule.layout = object["layout"].toString();
+
+        if (!known || rule.layout.isEmpty()) {
+            blog(LOG_WARNING, "Ignoring invalid dock layout rule for event '%s'", id.constData());
+            continue;
+        }
+        ruleList.append(rule);
+    }
+
+    compile();
+}
+
+void LayoutRules::save() const
+{
+    QJsonArray array;
+    for (const Rule &rule : ruleList) {
+        QJsonObject object;
+        object["event"] = QString::fromLatin1(triggerId(rule.trigger));
+        if (!rule.pattern.isEmpty())
+            object["pattern"] = rule.pattern;
+        object["layout"] = rule.layout;
+        array.append(object);
+    }
+
+    QJsonObject root;
+    root["rules"] = array;
+    LayoutStore::instance().setSetting(rulesSettingKey,
+                                       QString::fromUtf8(QJsonDocument(root).toJson(QJsonDocument::Compact)));
+}
+
+void LayoutRules::setRules(const QVector<Rule> &rules)
+{
+    ruleList = rules;
+    save();
+    compile();
+}
+
+void LayoutRules::setDebounceMs(int milliseconds)
+{
+    debounceTimer.setInterval(milliseconds);
+    LayoutStore::instance().setSetting(debounceSettingKey, QString::number(milliseconds));
+}
+
+void LayoutRules::compile()
+{
+    for (CompiledTrigger &table : compiled)
+        table = CompiledTrigger();
+
+    // Earlier rules win, so later duplicates are not inserted
+    for (const Rule &rule : ruleList) {
+        CompiledTrigger &table = compiled[int(rule.trigger)];
+
+        if (rule.pattern.isEmpty() || !triggerHasName(rule.trigger)) {
+            if (table.fallback.isEmpty())
+                table.fallback = rule.layout;
+        } else if (is_wildcard(rule.pattern)) {
+            QRegularExpression expression(QRegularExpression::wildcardToRegularExpression(rule.pattern),
+                                          QRegularExpression::CaseInsensitiveOption);
+            expression.optimize();
+            table.patterns.append(qMakePair(expression, rule.layout));
+        } else {
+            const QString key = rule.pattern.toCaseFolded();
+            if (!table.exact.contains(key))
+                table.exact.insert(key, rule.layout);
+        }
+    }
+}
+
+QString LayoutRules::match(Trigger trigger, const QString &name) const
+{
+    const CompiledTrigger &table = compiled[int(trigger)];
+
+    auto exact = table.exact.constFind(name.toCaseFolded());
+    if (exact != table.exact.constEnd())
+        return *exact;
+
+    for (const auto &pattern : table.patterns) {
+        if (pattern.first.match(name).hasMatch())
+            return pattern.second;
+    }
+
+    return table.fallback;
+}
+
+void LayoutRules::handleFrontendEvent(enum obs_frontend_event event)
+{
+    if (!active || ruleList.isEmpty())
+        return;
+
+    switch (event) {
+    case OBS_FRONTEND_EVENT_SCENE_CHANGED:
+        queueSwitch(Trigger::SceneChanged, current_scene_name());
+        break;
+    case OBS_FRONTEND_EVENT_PROFILE_CHANGED:
+        queueSwitch(Trigger::ProfileChanged, take_string(obs_frontend_get_current_profile()));
+        break;
+    case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED:
+        queueSwitch(Trigger::SceneCollectionChanged, take_string(obs_frontend_get_current_scene_collection()));
+        break;
+    case OBS_FRONTEND_EVENT_STREAMING_STARTED:
+        queueSwitch(Trigger::StreamingStarted, QString());
+        break;
+    case OBS_FRONTEND_EVENT_RECORDING_STARTED:
+        queueSwitch(Trigger::RecordingStarted, QString());
+        break;
+    default:
+        break;
+    }
+}
+
+void LayoutRules::queueSwitch(Trigger trigger, const QString &name)
+{
+    // The last event of a burst decides, also when it matches no rule
+    const QString layout = match(trigger, name);
+    if (layout.isEmpty()) {
+        if (!pendingLayout.isEmpty()) {
+            blog(LOG_DEBUG, "Dropped the switch to dock layout '%s', no rule matches %s: %s",
+                 pendingLayout.toUtf8().constData(), triggerLabel(trigger).toUtf8().constData(),
+                 name.toUtf8().constData());
+        }
+        debounceTimer.stop();
+        pendingLayout.clear();
+        pendingReason.clear();
+        return;
+    }
+
+    pendingLayout = layout;
+    pendingReason = name.isEmpty() ? triggerLabel(trigger) : QStringLiteral("%1: %2").arg(triggerLabel(trigger), name);
+    debounceTimer.start();
+}
+
+void LayoutRules::applyPending()
+{
+    const QString layout = pendingLayout;
+    pendingLayout.clear();
+    if (!active || layout.isEmpty())
+        return;
+
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    if (!scheduler)
+        return;
+
+    // Partial layouts only move their own docks and never become current
+    if (PartialLayout::isPartial(layout)) {
+        blog(LOG_INFO, "Applying partial dock layout '%s' (%s)", layout.toUtf8().constData(),
+             pendingReason.toUtf8().constData());
+        PartialLayout::apply({layout});
+        return;
+    }
+
+    if (scheduler->currentLayout() == layout) {
+        blog(LOG_DEBUG, "Dock layout '%s' is already shown (%s)", layout.toUtf8().constData(),
+             pendingReason.toUtf8().constData());
+        return;
+    }
+
+    const QByteArray windowState = LayoutStore::instance().windowState(layout, ScreenConfig::instance().currentKey());
+    if (windowState.isEmpty()) {
+        blog(LOG_WARNING, "Dock layout rule for %s refers to missing layout '%s'", pendingReason.toUtf8().constData(),
+             layout.toUtf8().constData());
+        return;
+    }
+
+    blog(LOG_INFO, "Switching to dock layout '%s' (%s)", layout.toUtf8().constData(),
+         pendingReason.toUtf8().constData());
+    scheduler->switchTo(layout, windowState);
+}
+
+void LayoutRules::onLayoutRenamed(const QString &oldName, const QString &newName)
+{
+    bool renamed = false;
+    for (Rule &rule : ruleList) {
+        if (rule.layout == oldName) {
+            rule.layout = newName;
+            renamed = true;
+        }
+    }
+
+    if (renamed) {
+        save();
+        compile();
+    }
+}
@@ -0,0 +1,99 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <obs-frontend-api.h>
+
+#include <QHash>
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+// Switches layouts automatically when OBS changes scene, profile or scene
+// collection, or starts streaming or recording.
+//
+// The rules are kept as JSON in the AutoSwitchRules setting and compiled into
+// one lookup table per trigger whenever they change, so an event costs a hash
+// lookup plus the wildcard patterns of its trigger. Events are debounced:
+// only the last one of a burst (e.g. rapid scene cuts) switches, and nothing
+// is applied when its layout is the one already shown.
+class LayoutRules : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Trigger {
+        SceneChanged,
+        ProfileChanged,
+        SceneCollectionChanged,
+        StreamingStarted,
+        RecordingStarted,
+    };
+
+    static constexpr int triggerCount = int(Trigger::RecordingStarted) + 1;
+    static constexpr int defaultDebounceMs = 300;
+
+    struct Rule {
+        Trigger trigger = Trigger::SceneChanged;
+        QString pattern; // Scene, profile or collection name; * and ? allowed, empty matches all
+        QString layout;
+    };
+
+    static LayoutRules &instance();
+
+    // Stable identifier used in the setting, and the text shown in the UI
+    static const char *triggerId(Trigger trigger);
+    static QString triggerLabel(Trigger trigger);
+    static bool triggerHasName(Trigger trigger);
+
+    // Reads the rules from the store and starts reacting to events
+    void start();
+    void stop();
+
+    QVector<Rule> rules() const { return ruleList; }
+    void setRules(const QVector<Rule> &rules);
+
+    int debounceMs() const { return debounceTimer.interval(); }
+    void setDebounceMs(int milliseconds);
+
+    // Layout for an event, or an empty string; exact names win over
+    // patterns, patterns are tried in rule order, catch-all rules come last
+    QString match(Trigger trigger, const QString &name) const;
+
+    void handleFrontendEvent(enum obs_frontend_event event);
+
+    // Debounces the switch for one event; an event no rule matches cancels
+    // the switch an earlier event of the burst queued
+    void queueSwitch(Trigger trigger, const QString &name);
+
+    // Layout the running debounce will switch to, or an empty string
+    QString pendingSwitch() const { return debounceTimer.isActive() ? pendingLayout : QString(); }
+
+private:
+    struct CompiledTrigger {
+        QHash<QString, QString> exact; // Case-folded name -> layout
+        QVector<QPair<QRegularExpression, QString>> patterns;
+        QString fallback;
+    };
+
+    LayoutRules();
+
+    void load();
+    void save() const;
+    void compile();
+    void applyPending();
+    void onLayoutRenamed(const QString &oldName, const QString &newName);
+
+    bool active = false;
+    bool following = false;
+    QVector<Rule> ruleList;
+    CompiledTrigger compiled[triggerCount];
+
+    QTimer debounceTimer;
+    QString pendingLayout;
+    QString pendingReason;
+};
@@ -0,0 +1,334 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-search.hpp"
+#include "diagnostics.hpp"
+#include "layout-store.hpp"
+#include "restore-scheduler.hpp"
+
+#include <obs-module.h>
+
+#include <QElapsedTimer>
+
+static const QString tagsKey = QStringLiteral("Tags");
+static const QString recentKey = QStringLiteral("RecentLayouts");
+
+// Older entries fall off the recently used list
+static constexpr int maxRecent = 100;
+
+static quint64 trigram_key(const QChar *chars)
+{
+    return (quint64(chars[0].unicode()) << 32) | (quint64(chars[1].unicode()) << 16) | quint64(chars[2].unicode());
+}
+
+static QSet<quint64> trigrams_of(const QString &text)
+{
+    QSet<quint64> grams;
+    for (int i = 0; i + 3 <= text.size(); ++i)
+        grams.insert(trigram_key(text.constData() + i));
+    return grams;
+}
+
+static QStringList words_of(const QString &text)
+{
+    QStringList words;
+    int start = -1;
+    for (int i = 0; i <= text.size(); ++i) {
+        const bool wordChar = i < text.size() && text.at(i).isLetterOrNumber();
+        if (wordChar && start < 0) {
+            start = i;
+        } else if (!wordChar && start >= 0) {
+            words.append(text.mid(start, i - start));
+            start = -1;
+        }
+    }
+    return words;
+}
+
+static QStringList split_lines(const QByteArray &value)
+{
+    QStringList lines;
+    for (const QString &line : QString::fromUtf8(value).split('\n')) {
+        const QString trimmed = line.trimmed();
+        if (!trimmed.isEmpty() && !lines.contains(trimmed))
+            lines.append(trimmed);
+    }
+    return lines;
+}
+
+LayoutSearch &LayoutSearch::instance()
+{
+    static LayoutSearch search;
+    return search;
+}
+
+LayoutSearch::LayoutSearch()
+{
+    LayoutStore &store = LayoutStore::instance();
+
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString &name : store.layoutNames())
+        addEntry(name);
+    blog(LOG_INFO, "Indexed %d layouts for search in %.2f ms", int(ids.size()), timer.nsecsElapsed() / 1e6);
+
+    setRecent(split_lines(store.setting(recentKey).toUtf8()), false);
+
+    connect(&store, &LayoutStore::layoutAdded, this, &LayoutSearch::indexLayout);
+    connect(&store, &LayoutStore::layoutChanged, this, &LayoutSearch::indexLayout);
+    connect(&store, &LayoutStore::layoutsReset, this, &LayoutSearch::onLayoutsReset);
+    connect(&store, &LayoutStore::layoutRemoved, this, &LayoutSearch::unindexLayout);
+    connect(&store, &LayoutStore::layoutRenamed, this, &LayoutSearch::onLayoutRenamed);
+}
+
+QHash<QString, int> LayoutSearch::search(const QString &query) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QHash<int, int> scores;
+    bool firstTerm = true;
+    for (const QString &term : query.toLower().split(' ', Qt::SkipEmptyParts)) {
+        QHash<int, int> termScores;
+
+        if (term.size() < 3) {
+            // Too short for a trigram, so only word starts count
+            for (int id : idsByPrefix.value(term))
+                termScores.insert(id, WordPrefix);
+        } else {
+            const QSet<quint64> grams = trigrams_of(term);
+            QHash<int, int> hits;
+            for (quint64 gram : grams) {
+                for (int id : idsByTrigram.value(gram))
+                    ++hits[id];
+            }
+
+            const int needed = (int(grams.size()) + 1) / 2;
+            for (auto it = hits.constBegin(); it != hits.constEnd(); ++it) {
+                if (it.value() < needed)
+                    continue;
+
+                const Entry &entry = entries[it.key()];
+                int score = FuzzyMatch;
+                if (entry.text.contains(term)) {
+                    score = Substring;
+                    for (const QString &word : entry.words) {
+                        if (word.startsWith(term)) {
+                            score = WordPrefix;
+                            break;
+                        }
+                    }
+                }
+                termScores.insert(it.key(), score);
+            }
+        }
+
+        // Every term has to match
+        if (firstTerm) {
+            scores = termScores;
+            firstTerm = false;
+        } else {
+            for (auto it = scores.begin(); it != scores.end();) {
+                const int termScore = termScores.value(it.key());
+                if (termScore == 0) {
+                    it = scores.erase(it);
+                } else {
+                    it.value() += termScore;
+                    ++it;
+                }
+            }
+        }
+        if (scores.isEmpty())
+            break;
+    }
+
+    QHash<QString, int> result;
+    result.reserve(scores.size());
+    for (auto it = scores.constBegin(); it != scores.constEnd(); ++it)
+        result.insert(entries[it.key()].name, it.value());
+
+    Diagnostics::record(Diagnostics::Phase::Search, timer.nsecsElapsed());
+    return result;
+}
+
+QStringList LayoutSearch::tags(const QString &name) const
+{
+    const int id = ids.value(name, -1);
+    return id >= 0 ? entries[id].tags : QStringList();
+}
+
+void LayoutSearch::setTags(const QString &name, const QStringList &tags)
+{
+    QStringList cleaned;
+    for (const QString &tag : tags) {
+        const QString trimmed = tag.trimmed();
+        if (!trimmed.isEmpty() && !cleaned.contains(trimmed))
+            cleaned.append(trimmed);
+    }
+
+    // Reindexed through layoutChanged
+    LayoutStore::instance().setValue(name, tagsKey, cleaned.join('\n').toUtf8());
+}
+
+void LayoutSearch::follow()
+{
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    if (following || !scheduler)
+        return;
+    following = true;
+
+    connect(scheduler, &RestoreScheduler::finished, this, &LayoutSearch::onSwitchFinished);
+}
+
+bool LayoutSearch::addEntry(const QString &name)
+{
+    const QStringList tags = split_lines(LayoutStore::instance().value(name, tagsKey));
+
+    int id = ids.value(name, -1);
+    if (id >= 0 && entries[id].tags == tags)
+        return false; // Only the window state changed
+
+    removeEntry(name);
+    if (!freeIds.isEmpty()) {
+        id = freeIds.takeLast();
+    } else {
+        id = int(entries.size());
+        entries.append(Entry());
+    }
+
+    Entry &entry = entries[id];
+    entry.name = name;
+    entry.tags = tags;
+    entry.text = (QStringList{name} + tags).join('\n').toLower();
+    entry.words = words_of(entry.text);
+    entry.trigrams = trigrams_of(entry.text);
+    for (const QString &word : entry.words) {
+        entry.prefixes.insert(word.left(1));
+        entry.prefixes.insert(word.left(2));
+    }
+
+    for (quint64 gram : entry.trigrams)
+        idsByTrigram[gram].insert(id);
+    for (const QString &prefix : entry.prefixes)
+        idsByPrefix[prefix].insert(id);
+    ids.insert(name, id);
+    return true;
+}
+
+void LayoutSearch::indexLayout(const QString &name)
+{
+    if (addEntry(name))
+        emit indexChanged();
+}
+
+void LayoutSearch::onLayoutsReset(const QStringList &names)
+{
+    bool changed = false;
+    for (const QString &name : names)
+        changed |= addEntry(name);
+    if (changed)
+        emit indexChanged();
+}
+
+void LayoutSearch::removeEntry(const QString &name)
+{
+    const int id = ids.value(name, -1);
+    if (id < 0)
+        return;
+    ids.remove(name);
+
+    Entry &entry = entries[id];
+    for (quint64 gram : entry.trigrams) {
+        auto it = idsByTrigram.find(gram);
+        it->remove(id);
+        if (it->isEmpty())
+            idsByTrigram.erase(it);
+    }
+    for (const QString &prefix : entry.prefixes) {
+        auto it = idsByPrefix.find(prefix);
+        it->remove(id);
+        if (it->isEmpty())
+            idsByPrefix.erase(it);
+    }
+    entry = Entry();
+    freeIds.append(id);
+}
+
+void LayoutSearch::unindexLayout(const QString &name)
+{
+    removeEntry(name);
+    if (recentRanks.contains(name))
+        setRecent(recent, true); // Drops names that are no longer indexed
+
+    emit indexChanged();
+}
+
+void LayoutSearch::onLayoutRenamed(const QString &oldName, const QString &newName)
+{
+    const int rank = recentRank(oldName);
+    removeEntry(oldName);
+    addEntry(newName);
+
+    if (rank >= 0) {
+        QStringList names = recent;
+        names[rank] = newName;
+        setRecent(names, true);
+    }
+    emit indexChanged();
+}
+
+void LayoutSearch::onSwitchFinished(const QString &name, bool ok)
+{
+    if (!ok)
+        return;
+
+    // Partial layouts restored together are reported as "A + B"
+    LayoutStore &store = LayoutStore::instance();
+    markUsed(store.contains(name) ? QStringList{name} : name.split(QStringLiteral(" + ")));
+}
+
+void LayoutSearch::markUsed(const QStringList &names)
+{
+    QStringList updated = recent;
+    for (const QString &name : names) {
+        if (!ids.contains(name))
+            continue;
+        updated.removeAll(name);
+        updated.prepend(name);
+    }
+    if (updated == recent)
+        return;
+
+    setRecent(updated, true);
+}
+
+void LayoutSearch::setRecent(const QStringList &names, bool save)
+{
+    const QHash<QString, int> previousRanks = recentRanks;
+    recent.clear();
+    recentRanks.clear();
+    for (const QString &name : names) {
+        if (recent.size() >= maxRecent)
+            break;
+        if (!ids.contains(name) || recentRanks.contains(name))
+            continue;
+        recentRanks.insert(name, int(recent.size()));
+        recent.append(name);
+    }
+    if (save)
+        LayoutStore::instance().setSetting(recentKey, recent.join('\n'));
+
+    // Views only re-sort the rows named here
+    QStringList changed;
+    for (auto it = previousRanks.cbegin(); it != previousRanks.cend(); ++it) {
+        if (recentRank(it.key()) != it.value())
+            changed.append(it.key());
+    }
+    for (const QString &name : recent) {
+        if (!previousRanks.contains(name))
+            changed.append(name);
+    }
+    if (!changed.isEmpty())
+        emit recentChanged(changed);
+}
@@ -0,0 +1,91 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Search index over layout names and tags, plus the recently used layouts.
+//
+// Every layout is indexed by the trigrams of its lowercased name and tags
+// and by the first one and two letters of each word, and the index follows
+// the store layout by layout. A query term of three or more letters looks
+// up its trigrams and keeps the layouts sharing at least half of them, so
+// small typos still match; shorter terms are word prefixes. Only those
+// candidates are compared against the text, which keeps a keystroke far
+// below a millisecond even with many thousands of layouts.
+//
+// Tags are stored with the layout as the "Tags" value, one per line. The
+// recently used list is the "RecentLayouts" setting.
+class LayoutSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Ranks of a match, summed over the terms of a query
+    enum Score {
+        FuzzyMatch = 1,
+        Substring = 2,
+        WordPrefix = 3,
+    };
+
+    static LayoutSearch &instance();
+
+    // Score of every layout matching all terms of the query; empty for an
+    // empty query
+    QHash<QString, int> search(const QString &query) const;
+
+    QStringList tags(const QString &name) const;
+    void setTags(const QString &name, const QStringList &tags);
+
+    // Position in the recently used list, most recent first; -1 if unused
+    int recentRank(const QString &name) const { return recentRanks.value(name, -1); }
+
+    // Moves layouts to the front of the recently used list whenever a
+    // switch to them finishes
+    void follow();
+
+signals:
+    void indexChanged();
+    // Layouts whose recentRank() changed
+    void recentChanged(const QStringList &names);
+
+private:
+    struct Entry {
+        QString name; // Empty for a free slot
+        QString text; // Lowercased name and tags, one per line
+        QStringList words;
+        QStringList tags;
+        QSet<quint64> trigrams;
+        QSet<QString> prefixes;
+    };
+
+    LayoutSearch();
+
+    // Returns false if the layout was indexed with the same tags already
+    bool addEntry(const QString &name);
+    void removeEntry(const QString &name);
+    void indexLayout(const QString &name);
+    void onLayoutsReset(const QStringList &names);
+    void unindexLayout(const QString &name);
+    void onLayoutRenamed(const QString &oldName, const QString &newName);
+    void onSwitchFinished(const QString &name, bool ok);
+    void markUsed(const QStringList &names);
+    void setRecent(const QStringList &names, bool save);
+
+    QVector<Entry> entries;
+    QVector<int> freeIds;
+    QHash<QString, int> ids;
+    QHash<quint64, QSet<int>> idsByTrigram;
+    QHash<QString, QSet<int>> idsByPrefix;
+
+    QStringList recent;
+    QHash<QString, int> recentRanks;
+    bool following = false;
+};
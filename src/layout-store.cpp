@@ -0,0 +1,1552 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-store.hpp"
+#include "layout-chunker.hpp"
+#include "diagnostics.hpp"
+
+#include <obs-module.h>
+#include <util/crc32.h>
+#include <util/platform.h>
+#include <QFileInfo>
+#include <QSettings>
+#include <QtEndian>
+
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Database layout (all integers little-endian):
+//
+//   header    "ODLM" | u32 version | u64 generation | u32 setting count
+//             | u32 layout count | u32 chunk count
+//   settings  { string key | string value } ...
+//   chunks    { 20 byte SHA-1 | u64 offset | u32 stored size | u32 raw size
+//               | u8 codec } ...
+//   index     { string name | u32 value count
+//               { string key | u32 size | u32 chunk count | u32 chunk id ... } ... } ...
+//   blobs     chunk bytes, back to back
+//
+// Strings are a u32 byte length followed by UTF-8. Chunk offsets are relative
+// to the start of the blob section, which begins right after the index.
+// Version 1 stored every value as a single length-prefixed blob without a
+// chunk table, version 2 had no generation; both are still read and are
+// rewritten in the current version.
+//
+// Journal layout (<database>.journal, same encoding):
+//
+//   header    "ODLJ" | u32 version | u64 generation
+//   records   { u32 payload size | u32 CRC-32 of payload | payload } ...
+//   payload   u8 JournalOp | arguments of the op
+//
+// Records are only replayed onto the database with the same generation; a
+// compaction writes the database with the next generation before it empties
+// the journal, so a crash in between leaves a journal that is ignored. A torn
+// or corrupt record ends the replay and is cut off.
+//
+// OBS instances sharing the plugin directory take <database>.lock around
+// every write. Holding it, a writer first applies the records other
+// instances appended since its last sync, or reloads the database if its
+// generation moved on, and only then appends its own records after theirs.
+static const char databaseMagic[4] = {'O', 'D', 'L', 'M'};
+static constexpr quint32 databaseVersion = 3;
+static const char journalMagic[4] = {'O', 'D', 'L', 'J'};
+static constexpr quint32 journalVersion = 1;
+static constexpr int chunkHashSize = 20;
+
+enum ChunkCodec : quint8 {
+    CodecRaw = 0,
+    CodecZlib = 1,
+};
+
+enum JournalOp : quint8 {
+    OpSetValue = 1,      // string name | string key | u32 size | bytes
+    OpRemoveLayout = 2,  // string name
+    OpRenameLayout = 3,  // string old name | string new name
+    OpSetSetting = 4,    // string key | string value
+    OpRemoveSetting = 5, // string key
+};
+
+// How long the writer waits for further changes before touching the disk
+static constexpr std::chrono::milliseconds writeCoalesceDelay(250);
+
+// Journal size at which the writer folds it into the database
+static constexpr qint64 journalCompactBytes = 256 * 1024;
+
+// Other instances only hold the lock for a single write
+static constexpr int sharedLockTimeoutMs = 2000;
+
+static const QString settingsGroup = QStringLiteral("Settings");
+static const QString windowStateKey = QStringLiteral("WindowState");
+static const QString windowStateVariantPrefix = QStringLiteral("WindowState@");
+static const QString defaultLayoutKey = QStringLiteral("DefaultLayout");
+static const QString compressLayoutsKey = QStringLiteral("CompressLayouts");
+
+namespace {
+
+// Bounds-checked cursor over the mapped database
+class BlobReader
+{
+public:
+    BlobReader(const uchar *data, qint64 size) : data(data), size(size) {}
+
+    bool readU8(quint8 &value)
+    {
+        if (pos + 1 > size)
+            return false;
+        value = data[pos++];
+        return true;
+    }
+
+    bool readU32(quint32 &value)
+    {
+        if (pos + 4 > size)
+            return false;
+        value = qFromLittleEndian<quint32>(data + pos);
+        pos += 4;
+        return true;
+    }
+
+    bool readU64(quint64 &value)
+    {
+        if (pos + 8 > size)
+            return false;
+        value = qFromLittleEndian<quint64>(data + pos);
+        pos += 8;
+        return true;
+    }
+
+    bool readString(QString &value)
+    {
+        quint32 length;
+        if (!readU32(length) || pos + length > size)
+            return false;
+        value = QString::fromUtf8(reinterpret_cast<const char *>(data + pos), int(length));
+        pos += length;
+        return true;
+    }
+
+    bool readBytes(const char *expected, qint64 length)
+    {
+        if (pos + length > size || memcmp(data + pos, expected, size_t(length)) != 0)
+            return false;
+        pos += length;
+        return true;
+    }
+
+    bool readRaw(const uchar *&bytes, qint64 length)
+    {
+        if (pos + length > size)
+            return false;
+        bytes = data + pos;
+        pos += length;
+        return true;
+    }
+
+    qint64 position() const { return pos; }
+
+private:
+    const uchar *data;
+    qint64 size;
+    qint64 pos = 0;
+};
+
+void appendU32(QByteArray &out, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), 4);
+}
+
+void appendU64(QByteArray &out, quint64 value)
+{
+    uchar bytes[8];
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), 8);
+}
+
+void appendString(QByteArray &out, const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    appendU32(out, quint32(utf8.size()));
+    out.append(utf8);
+}
+
+QByteArray journalRecord(JournalOp op, const QString &first, const QString &second = QString())
+{
+    QByteArray record;
+    record.append(char(op));
+    appendString(record, first);
+    if (op == OpRenameLayout || op == OpSetSetting || op == OpSetValue)
+        appendString(record, second);
+    return record;
+}
+
+// Magic, version and generation at the start of a database or journal file
+bool readFileHeader(const QString &path, const char *magic, quint32 &version, quint64 &fileGeneration)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QByteArray header = file.read(16);
+    BlobReader reader(reinterpret_cast<const uchar *>(header.constData()), header.size());
+    return reader.readBytes(magic, 4) && reader.readU32(version) && reader.readU64(fileGeneration);
+}
+
+// Databases before version 3 have no generation and count as 0
+bool readDatabaseGeneration(const QString &path, quint64 &fileGeneration)
+{
+    quint32 version;
+    if (!readFileHeader(path, databaseMagic, version, fileGeneration))
+        return false;
+    if (version < 3)
+        fileGeneration = 0;
+    return true;
+}
+
+bool readJournalGeneration(const QString &path, quint64 &fileGeneration)
+{
+    quint32 version;
+    return readFileHeader(path, journalMagic, version, fileGeneration) && version == journalVersion;
+}
+
+// Flushes stdio buffers and waits until the bytes are on the disk
+bool syncFile(FILE *file)
+{
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+LayoutStore::MappedFile::~MappedFile()
+{
+    if (data)
+        file.unmap(const_cast<uchar *>(data));
+}
+
+std::shared_ptr<LayoutStore::MappedFile> LayoutStore::mapFile(const QString &path)
+{
+    auto mapped = std::make_shared<MappedFile>();
+    mapped->file.setFileName(path);
+    if (!mapped->file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    mapped->size = mapped->file.size();
+    if (mapped->size > 0)
+        mapped->data = mapped->file.map(0, mapped->size);
+    if (!mapped->data)
+        return nullptr;
+
+    return mapped;
+}
+
+LayoutStore &LayoutStore::instance()
+{
+    static LayoutStore store;
+    return store;
+}
+
+LayoutStore::~LayoutStore()
+{
+    shutdown();
+}
+
+void LayoutStore::load(const QString &databasePath, const QString &legacyIniPath)
+{
+    Diagnostics::ScopedTimer loadTimer(Diagnostics::Phase::FileLoad);
+    std::lock_guard<std::mutex> lock(mutex);
+    filePath = databasePath;
+    journalPath = databasePath + QStringLiteral(".journal");
+    writtenRevision = revision;
+
+    // Another instance may be in the middle of a write
+    sharedLock = std::make_unique<QLockFile>(databasePath + QStringLiteral(".lock"));
+    const bool locked = sharedLock->tryLock(sharedLockTimeoutMs);
+    if (!locked)
+        blog(LOG_WARNING, "Dock layout database '%s' stayed locked by another instance, loading it anyway",
+             databasePath.toUtf8().constData());
+
+    bool opened = false;
+    if (QFile::exists(databasePath)) {
+        opened = openDatabase(databasePath);
+        if (!opened) {
+            // Keep the unreadable file for inspection instead of overwriting it
+            const QString asidePath = databasePath + QStringLiteral(".corrupt");
+            QFile::remove(asidePath);
+            QFile::rename(databasePath, asidePath);
+            blog(LOG_WARNING, "Dock layout database is unreadable, moved it to '%s'",
+                 asidePath.toUtf8().constData());
+        }
+    }
+
+    // The INI is left untouched so that older plugin versions keep working
+    if (!opened && QFile::exists(legacyIniPath) && migrateIni(legacyIniPath))
+        requestCompaction();
+
+    // Without a journal every write rewrites the database
+    if (!replayJournal())
+        blog(LOG_WARNING, "Failed to open dock layout journal '%s'", journalPath.toUtf8().constData());
+
+    if (locked)
+        sharedLock->unlock();
+
+    // Writes of other instances are picked up without polling
+    for (const QString &path : {filePath, journalPath}) {
+        if (QFile::exists(path))
+            watcher.addPath(path);
+    }
+    connect(&watcher, &QFileSystemWatcher::fileChanged, this, &LayoutStore::onSharedFileChanged, Qt::UniqueConnection);
+
+    if (!writer.joinable()) {
+        stopping = false;
+        writer = std::thread(&LayoutStore::writerLoop, this);
+    }
+
+    const Stats loaded = computeStats();
+    blog(LOG_INFO, "Loaded %d dock layouts (%lld bytes stored as %lld in %d chunks, dedup ratio %.2fx)",
+         loaded.layouts, loaded.logicalBytes, loaded.storedBytes, loaded.chunks, loaded.dedupRatio());
+}
+
+// Must be called with the mutex held
+bool LayoutStore::openDatabase(const QString &path)
+{
+    LoadedDatabase loaded;
+    if (!readDatabase(path, loaded))
+        return false;
+
+    useDatabase(loaded);
+    return true;
+}
+
+// Any thread, without the mutex; touches no member
+bool LayoutStore::readDatabase(const QString &path, LoadedDatabase &loaded)
+{
+    std::shared_ptr<MappedFile> mapped = mapFile(path);
+    if (!mapped)
+        return false;
+
+    BlobReader reader(mapped->data, mapped->size);
+    if (!reader.readBytes(databaseMagic, sizeof(databaseMagic)) || !reader.readU32(loaded.version))
+        return false;
+
+    if (!readIndex(*mapped, loaded.version, loaded.layouts, loaded.settings, loaded.chunks, loaded.generation))
+        return false;
+
+    loaded.mapping = std::move(mapped);
+    return true;
+}
+
+// Must be called with the mutex held
+void LayoutStore::useDatabase(LoadedDatabase &loaded)
+{
+    mapping = std::move(loaded.mapping);
+    chunks = std::move(loaded.chunks);
+    layouts = std::move(loaded.layouts);
+    settings = std::move(loaded.settings);
+    generation = loaded.generation;
+
+    // Old versions are rewritten in the current format
+    if (loaded.version != databaseVersion)
+        requestCompaction();
+}
+
+bool LayoutStore::readIndex(const MappedFile &mapped, quint32 version, Layouts &loadedLayouts,
+                            QMap<QString, QString> &loadedSettings, QVector<ChunkRef> &loadedChunks,
+                            quint64 &loadedGeneration)
+{
+    if (version < 1 || version > databaseVersion)
+        return false;
+
+    BlobReader reader(mapped.data, mapped.size);
+    reader.readBytes(databaseMagic, sizeof(databaseMagic));
+    quint32 ignoredVersion, settingCount, layoutCount, chunkCount = 0;
+    if (!reader.readU32(ignoredVersion) || (version >= 3 && !reader.readU64(loadedGeneration)) ||
+        !reader.readU32(settingCount) || !reader.readU32(layoutCount) ||
+        (version >= 2 && !reader.readU32(chunkCount)))
+        return false;
+
+    for (quint32 i = 0; i < settingCount; ++i) {
+        QString key, value;
+        if (!reader.readString(key) || !reader.readString(value))
+            return false;
+        loadedSettings.insert(key, value);
+    }
+
+    loadedChunks.reserve(int(chunkCount));
+    for (quint32 i = 0; i < chunkCount; ++i) {
+        const uchar *hash;
+        ChunkRef chunk;
+        if (!reader.readRaw(hash, chunkHashSize) || !reader.readU64(chunk.offset) ||
+            !reader.readU32(chunk.storedSize) || !reader.readU32(chunk.rawSize) || !reader.readU8(chunk.codec) ||
+            (chunk.codec != CodecRaw && chunk.codec != CodecZlib))
+            return false;
+        chunk.hash = QByteArray(reinterpret_cast<const char *>(hash), chunkHashSize);
+        loadedChunks.append(chunk);
+    }
+
+    // Version 1 blobs, turned into one chunk per value below
+    struct LegacyBlob {
+        QString name;
+        QString key;
+        quint64 offset;
+    };
+    QVector<LegacyBlob> legacyBlobs;
+
+    loadedLayouts.reserve(int(layoutCount));
+    for (quint32 i = 0; i < layoutCount; ++i) {
+        QString name;
+        quint32 valueCount;
+        if (!reader.readString(name) || !reader.readU32(valueCount))
+            return false;
+
+        LayoutValues &values = loadedLayouts[name];
+        for (quint32 j = 0; j < valueCount; ++j) {
+            QString key;
+            StoredValue value;
+            value.mapped = true;
+            if (!reader.readString(key))
+                return false;
+
+            if (version == 1) {
+                quint64 offset;
+                if (!reader.readU64(offset) || !reader.readU32(value.size))
+                    return false;
+                values.insert(key, value);
+                legacyBlobs.append({name, key, offset});
+                continue;
+            }
+
+            quint32 valueChunkCount;
+            if (!reader.readU32(value.size) || !reader.readU32(valueChunkCount))
+                return false;
+
+            quint64 reconstructedSize = 0;
+            value.chunks.reserve(int(valueChunkCount));
+            for (quint32 k = 0; k < valueChunkCount; ++k) {
+                quint32 id;
+                if (!reader.readU32(id) || id >= chunkCount)
+                    return false;
+                value.chunks.append(id);
+                reconstructedSize += loadedChunks[int(id)].rawSize;
+            }
+            if (reconstructedSize != value.size)
+                return false;
+            values.insert(key, value);
+        }
+    }
+
+    const quint64 blobBase = quint64(reader.position());
+    for (ChunkRef &chunk : loadedChunks) {
+        chunk.offset += blobBase;
+        if (chunk.offset + chunk.storedSize > quint64(mapped.size))
+            return false;
+    }
+
+    for (const LegacyBlob &legacy : legacyBlobs) {
+        StoredValue &value = loadedLayouts[legacy.name][legacy.key];
+        const quint64 offset = blobBase + legacy.offset;
+        if (offset + 4 + value.size > quint64(mapped.size) ||
+            qFromLittleEndian<quint32>(mapped.data + offset) != value.size)
+            return false;
+
+        ChunkRef chunk;
+        chunk.offset = offset + 4;
+        chunk.storedSize = chunk.rawSize = value.size;
+        chunk.hash = LayoutChunker::hash(reinterpret_cast<const char *>(mapped.data + chunk.offset), int(value.size));
+        value.chunks.append(quint32(loadedChunks.size()));
+        loadedChunks.append(chunk);
+    }
+
+    return true;
+}
+
+// Must be called with the mutex held
+bool LayoutStore::migrateIni(const QString &iniPath)
+{
+    QSettings ini(iniPath, QSettings::IniFormat);
+    for (const QString &group : ini.childGroups()) {
+        ini.beginGroup(group);
+        if (group == settingsGroup) {
+            for (const QString &key : ini.childKeys())
+                settings.insert(key, ini.value(key).toString());
+        } else {
+            LayoutValues &values = layouts[group];
+            for (const QString &key : ini.childKeys()) {
+                StoredValue value;
+                value.data = ini.value(key).toByteArray();
+                values.insert(key, value);
+            }
+        }
+        ini.endGroup();
+    }
+
+    blog(LOG_INFO, "Migrating %d dock layouts from '%s'", int(layouts.size()), iniPath.toUtf8().constData());
+    return !layouts.isEmpty() || !settings.isEmpty();
+}
+
+// Must be called with the mutex held, before the writer starts
+bool LayoutStore::replayJournal()
+{
+    QByteArray data;
+    QFile file(journalPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        data = file.readAll();
+        file.close();
+    }
+
+    BlobReader reader(reinterpret_cast<const uchar *>(data.constData()), data.size());
+    quint32 version;
+    quint64 journalGeneration;
+    if (!reader.readBytes(journalMagic, sizeof(journalMagic)) || !reader.readU32(version) ||
+        version != journalVersion || !reader.readU64(journalGeneration) || journalGeneration != generation) {
+        // Missing, or left over from before the last compaction
+        return resetJournal(generation);
+    }
+
+    int replayed = 0;
+    const qint64 validSize = applyJournalRecords(data, reader.position(), nullptr, replayed);
+
+    if (validSize < data.size()) {
+        // Appends continue right after the last good record
+        blog(LOG_WARNING, "Dropped %lld bytes of incomplete dock layout journal records",
+             qint64(data.size()) - validSize);
+        if (!QFile::resize(journalPath, validSize)) {
+            // The replayed changes reach the disk with the next rewrite
+            requestCompaction();
+            return false;
+        }
+    }
+
+    journal = os_fopen(journalPath.toUtf8().constData(), "ab");
+    journalSize = validSize;
+    if (replayed > 0)
+        blog(LOG_INFO, "Replayed %d dock layout changes from the journal", replayed);
+    return journal != nullptr;
+}
+
+// Must be called with the mutex held. Applies the framed records of data from
+// offset on and returns where the last intact one ends.
+qint64 LayoutStore::applyJournalRecords(const QByteArray &data, qint64 offset, QSet<QString> *touched, int &applied)
+{
+    BlobReader reader(reinterpret_cast<const uchar *>(data.constData()) + offset, data.size() - offset);
+    qint64 validSize = 0;
+    for (;;) {
+        quint32 size, crc;
+        const uchar *payload;
+        if (!reader.readU32(size) || !reader.readU32(crc) || !reader.readRaw(payload, size) ||
+            calc_crc32(0, payload, size) != crc || !applyJournalRecord(payload, size, touched))
+            break;
+        validSize = reader.position();
+        ++applied;
+    }
+    return offset + validSize;
+}
+
+// Must be called with the mutex held. touched collects the layouts the
+// record changes.
+bool LayoutStore::applyJournalRecord(const uchar *payload, quint32 size, QSet<QString> *touched)
+{
+    BlobReader reader(payload, size);
+    quint8 op;
+    QString first, second;
+    if (!reader.readU8(op) || !reader.readString(first))
+        return false;
+
+    switch (op) {
+    case OpSetValue: {
+        quint32 length;
+        const uchar *bytes;
+        if (!reader.readString(second) || !reader.readU32(length) || !reader.readRaw(bytes, length))
+            return false;
+        StoredValue stored;
+        stored.data = QByteArray(reinterpret_cast<const char *>(bytes), int(length));
+        layouts[first].insert(second, stored);
+        if (touched)
+            touched->insert(first);
+        return true;
+    }
+    case OpRemoveLayout:
+        layouts.remove(first);
+        if (touched)
+            touched->insert(first);
+        if (settings.value(defaultLayoutKey) == first)
+            settings.remove(defaultLayoutKey);
+        return true;
+    case OpRenameLayout:
+        if (!reader.readString(second))
+            return false;
+        if (layouts.contains(first) && !layouts.contains(second)) {
+            layouts.insert(second, layouts.take(first));
+            if (settings.value(defaultLayoutKey) == first)
+                settings.insert(defaultLayoutKey, second);
+        }
+        if (touched) {
+            touched->insert(first);
+            touched->insert(second);
+        }
+        return true;
+    case OpSetSetting:
+        if (!reader.readString(second))
+            return false;
+        settings.insert(first, second);
+        return true;
+    case OpRemoveSetting:
+        settings.remove(first);
+        return true;
+    }
+    return false;
+}
+
+// Writer thread only
+bool LayoutStore::appendJournal(const QVector<QByteArray> &records)
+{
+    if (!journal)
+        return false;
+    if (records.isEmpty())
+        return true;
+
+    QByteArray frames;
+    for (const QByteArray &payload : records) {
+        appendU32(frames, quint32(payload.size()));
+        appendU32(frames, calc_crc32(0, payload.constData(), size_t(payload.size())));
+        frames.append(payload);
+    }
+
+    if (fwrite(frames.constData(), 1, size_t(frames.size()), journal) != size_t(frames.size()) ||
+        !syncFile(journal))
+        return false;
+
+    journalSize += frames.size();
+    return true;
+}
+
+// Writer thread only, or load()
+bool LayoutStore::resetJournal(quint64 journalGeneration)
+{
+    if (journal) {
+        fclose(journal);
+        journal = nullptr;
+    }
+    journalSize = 0;
+
+    FILE *file = os_fopen(journalPath.toUtf8().constData(), "wb");
+    if (!file)
+        return false;
+
+    QByteArray header;
+    header.append(journalMagic, sizeof(journalMagic));
+    appendU32(header, journalVersion);
+    appendU64(header, journalGeneration);
+    if (fwrite(header.constData(), 1, size_t(header.size()), file) != size_t(header.size()) || !syncFile(file)) {
+        fclose(file);
+        return false;
+    }
+
+    journal = file;
+    journalSize = header.size();
+    return true;
+}
+
+bool LayoutStore::exportIni(const QString &iniPath) const
+{
+    QHash<QString, QMap<QString, QByteArray>> exported;
+    QMap<QString, QString> exportedSettings;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = layouts.constBegin(); it != layouts.constEnd(); ++it) {
+            QMap<QString, QByteArray> &values = exported[it.key()];
+            for (auto value = it->constBegin(); value != it->constEnd(); ++value)
+                values.insert(value.key(), valueBytes(value.value()));
+        }
+        exportedSettings = settings;
+    }
+
+    // QSettings merges into an existing file, so start from scratch
+    QFile::remove(iniPath);
+
+    QSettings ini(iniPath, QSettings::IniFormat);
+    for (auto it = exported.constBegin(); it != exported.constEnd(); ++it) {
+        ini.beginGroup(it.key());
+        for (auto value = it->constBegin(); value != it->constEnd(); ++value)
+            ini.setValue(value.key(), value.value());
+        ini.endGroup();
+    }
+
+    ini.beginGroup(settingsGroup);
+    for (auto it = exportedSettings.constBegin(); it != exportedSettings.constEnd(); ++it)
+        ini.setValue(it.key(), it.value());
+    ini.endGroup();
+
+    ini.sync();
+    return ini.status() == QSettings::NoError;
+}
+
+void LayoutStore::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!writer.joinable())
+        return;
+
+    ++flushWaiters;
+    writerWake.notify_all();
+    writerDone.wait(lock, [this] { return writtenRevision == revision; });
+    --flushWaiters;
+}
+
+void LayoutStore::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!writer.joinable())
+            return;
+        stopping = true;
+    }
+    writerWake.notify_all();
+
+    // The writer drains pending changes before it exits
+    writer.join();
+
+    if (!watcher.files().isEmpty())
+        watcher.removePaths(watcher.files());
+
+    if (journal) {
+        fclose(journal);
+        journal = nullptr;
+    }
+}
+
+// Must be called with the mutex held
+QByteArray LayoutStore::valueBytes(const StoredValue &value) const
+{
+    if (!value.mapped)
+        return value.data;
+    if (!mapping)
+        return QByteArray();
+
+    Diagnostics::ScopedTimer decodeTimer(Diagnostics::Phase::BlobDecode);
+
+    // Only this value's chunks are touched
+    QByteArray bytes;
+    bytes.reserve(int(value.size));
+    for (quint32 id : value.chunks) {
+        const ChunkRef &chunk = chunks[int(id)];
+        const uchar *stored = mapping->data + chunk.offset;
+        if (chunk.codec == CodecZlib)
+            bytes.append(qUncompress(stored, int(chunk.storedSize)));
+        else
+            bytes.append(reinterpret_cast<const char *>(stored), int(chunk.storedSize));
+    }
+    return bytes;
+}
+
+QStringList LayoutStore::layoutNames() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    QStringList names = layouts.keys();
+    names.sort();
+    return names;
+}
+
+bool LayoutStore::contains(const QString &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return layouts.contains(name);
+}
+
+QByteArray LayoutStore::windowState(const QString &name, const QString &screenKey) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = layouts.constFind(name);
+    if (it == layouts.constEnd())
+        return QByteArray();
+
+    auto found = it->constEnd();
+    if (!screenKey.isEmpty())
+        found = it->constFind(windowStateVariantPrefix + screenKey);
+    if (found == it->constEnd())
+        found = it->constFind(windowStateKey);
+    if (found == it->constEnd())
+        return QByteArray();
+    return valueBytes(found.value());
+}
+
+void LayoutStore::setWindowState(const QString &name, const QByteArray &windowState, const QString &screenKey)
+{
+    bool added;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        added = !layouts.contains(name);
+
+        // The plain state always follows the latest save, so screens
+        // without a variant of their own get the most recent one
+        insertValue(name, windowStateKey, windowState);
+        if (!screenKey.isEmpty())
+            insertValue(name, windowStateVariantPrefix + screenKey, windowState);
+    }
+
+    if (added)
+        emit layoutAdded(name);
+    else
+        emit layoutChanged(name);
+}
+
+bool LayoutStore::hasWindowStateVariant(const QString &name, const QString &screenKey) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = layouts.constFind(name);
+    return it != layouts.constEnd() && it->contains(windowStateVariantPrefix + screenKey);
+}
+
+QByteArray LayoutStore::value(const QString &name, const QString &key) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = layouts.constFind(name);
+    if (it == layouts.constEnd())
+        return QByteArray();
+
+    auto found = it->constFind(key);
+    if (found == it->constEnd())
+        return QByteArray();
+    return valueBytes(found.value());
+}
+
+void LayoutStore::setValue(const QString &name, const QString &key, const QByteArray &bytes)
+{
+    bool added;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        added = !layouts.contains(name);
+        insertValue(name, key, bytes);
+    }
+
+    if (added)
+        emit layoutAdded(name);
+    else
+        emit layoutChanged(name);
+}
+
+QMap<QString, QByteArray> LayoutStore::values(const QString &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    QMap<QString, QByteArray> result;
+    auto it = layouts.constFind(name);
+    if (it == layouts.constEnd())
+        return result;
+
+    for (auto value = it->constBegin(); value != it->constEnd(); ++value)
+        result.insert(value.key(), valueBytes(value.value()));
+    return result;
+}
+
+void LayoutStore::setLayouts(const LayoutBatch &batch)
+{
+    if (batch.isEmpty())
+        return;
+
+    QStringList names;
+    names.reserve(batch.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const QString defaultName = settings.value(defaultLayoutKey);
+        for (const auto &entry : batch) {
+            const QString &name = entry.first;
+            if (layouts.contains(name)) {
+                // Keys the new values lack must not survive the replace
+                layouts.remove(name);
+                logMutation(journalRecord(OpRemoveLayout, name));
+                if (name == defaultName)
+                    logMutation(journalRecord(OpSetSetting, defaultLayoutKey, name));
+            }
+            names.append(name);
+
+            layouts.insert(name, LayoutValues());
+            for (auto value = entry.second.constBegin(); value != entry.second.constEnd(); ++value)
+                insertValue(name, value.key(), value.value());
+        }
+    }
+
+    names.removeDuplicates();
+    emit layoutsReset(names);
+}
+
+// Must be called with the mutex held
+void LayoutStore::insertValue(const QString &name, const QString &key, const QByteArray &bytes)
+{
+    StoredValue stored;
+    stored.data = bytes;
+    layouts[name].insert(key, stored);
+
+    QByteArray record = journalRecord(OpSetValue, name, key);
+    appendU32(record, quint32(bytes.size()));
+    record.append(bytes);
+    logMutation(record);
+}
+
+bool LayoutStore::renameLayout(const QString &oldName, const QString &newName)
+{
+    bool defaultRenamed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!layouts.contains(oldName) || layouts.contains(newName))
+            return false;
+
+        layouts.insert(newName, layouts.take(oldName));
+        defaultRenamed = settings.value(defaultLayoutKey) == oldName;
+        if (defaultRenamed)
+            settings.insert(defaultLayoutKey, newName);
+        logMutation(journalRecord(OpRenameLayout, oldName, newName));
+    }
+
+    emit layoutRenamed(oldName, newName);
+    if (defaultRenamed)
+        emit defaultLayoutChanged(newName);
+    return true;
+}
+
+void LayoutStore::removeLayout(const QString &name)
+{
+    bool defaultRemoved;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!layouts.remove(name))
+            return;
+
+        defaultRemoved = settings.value(defaultLayoutKey) == name;
+        if (defaultRemoved)
+            settings.remove(defaultLayoutKey);
+        logMutation(journalRecord(OpRemoveLayout, name));
+    }
+
+    emit layoutRemoved(name);
+    if (defaultRemoved)
+        emit defaultLayoutChanged(QString());
+}
+
+QString LayoutStore::defaultLayout() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.value(defaultLayoutKey);
+}
+
+void LayoutStore::setDefaultLayout(const QString &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (name.isEmpty()) {
+            settings.remove(defaultLayoutKey);
+            logMutation(journalRecord(OpRemoveSetting, defaultLayoutKey));
+        } else {
+            settings.insert(defaultLayoutKey, name);
+            logMutation(journalRecord(OpSetSetting, defaultLayoutKey, name));
+        }
+    }
+
+    emit defaultLayoutChanged(name);
+}
+
+QString LayoutStore::setting(const QString &key) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.value(key);
+}
+
+void LayoutStore::setSetting(const QString &key, const QString &value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (settings.value(key) == value)
+        return;
+
+    settings.insert(key, value);
+    logMutation(journalRecord(OpSetSetting, key, value));
+}
+
+// Must be called with the mutex held
+void LayoutStore::logMutation(const QByteArray &record)
+{
+    pendingRecords.append(record);
+    markDirty();
+}
+
+// Must be called with the mutex held
+void LayoutStore::requestCompaction()
+{
+    compactRequested = true;
+    markDirty();
+}
+
+// Must be called with the mutex held
+void LayoutStore::markDirty()
+{
+    ++revision;
+    writerWake.notify_one();
+}
+
+// UI thread. Also fires for this instance's own writes; the writer tells
+// them apart.
+void LayoutStore::onSharedFileChanged()
+{
+    // Files replaced by a rename drop out of the watch list
+    const QStringList watched = watcher.files();
+    for (const QString &path : {filePath, journalPath}) {
+        if (!watched.contains(path) && QFile::exists(path))
+            watcher.addPath(path);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    syncRequested = true;
+    writerWake.notify_one();
+}
+
+// Writer thread only. Readers of this instance are not blocked while another
+// instance holds the lock.
+bool LayoutStore::lockShared(std::unique_lock<std::mutex> &lock)
+{
+    if (!sharedLock)
+        return false;
+
+    lock.unlock();
+    const bool locked = sharedLock->tryLock(sharedLockTimeoutMs);
+    lock.lock();
+    return locked;
+}
+
+// Writer thread only. Whether another instance wrote since the last sync;
+// only the file headers and the journal size are read.
+bool LayoutStore::sharedFilesChanged() const
+{
+    quint64 diskGeneration;
+    if (readDatabaseGeneration(filePath, diskGeneration) && diskGeneration != generation)
+        return true;
+    if (!readJournalGeneration(journalPath, diskGeneration))
+        return true;
+    return diskGeneration != generation || QFileInfo(journalPath).size() != journalSize;
+}
+
+// Writer thread only, with the mutex held and the shared lock taken. Applies
+// what other instances wrote since the last sync; records are this
+// instance's changes that are not on disk yet and end up after theirs.
+// The files are read and indexed with the mutex unlocked, so readers of this
+// instance only wait while the results are swapped in and replayed.
+void LayoutStore::catchUp(std::unique_lock<std::mutex> &lock, const QVector<QByteArray> &records)
+{
+    // The file names, the generation and the journal size are only changed
+    // by this thread
+    lock.unlock();
+    if (!sharedFilesChanged()) {
+        lock.lock();
+        return;
+    }
+
+    quint64 diskGeneration;
+    const bool reload = readDatabaseGeneration(filePath, diskGeneration) && diskGeneration != generation;
+    LoadedDatabase loaded;
+    const bool loadedOk = reload && readDatabase(filePath, loaded);
+
+    const qint64 start = reload ? 16 : journalSize;
+    QByteArray data;
+    bool journalRead = false;
+    if (!reload || loadedOk) {
+        QFile file(journalPath);
+        if (readJournalGeneration(journalPath, diskGeneration) &&
+            diskGeneration == (reload ? loaded.generation : generation) && file.open(QIODevice::ReadOnly) &&
+            file.size() >= start) {
+            if (file.seek(start))
+                data = file.readAll();
+            journalRead = true;
+        }
+    }
+    lock.lock();
+
+    if (reload && !loadedOk) {
+        blog(LOG_WARNING, "Failed to reload dock layout database '%s' written by another instance",
+             filePath.toUtf8().constData());
+        requestCompaction();
+        return;
+    }
+
+    const Layouts before = layouts;
+    const QString defaultBefore = settings.value(defaultLayoutKey);
+    QSet<QString> foreign;
+
+    if (reload) {
+        useDatabase(loaded);
+        Diagnostics::addToCounter(Diagnostics::Counter::SharedReloads, 1);
+
+        // The compaction folded in records that are not around anymore, so
+        // every layout counts as changed
+        for (auto it = before.keyBegin(); it != before.keyEnd(); ++it)
+            foreign.insert(*it);
+        for (auto it = layouts.keyBegin(); it != layouts.keyEnd(); ++it)
+            foreign.insert(*it);
+
+        // Appends go to the journal of the new generation
+        if (journal) {
+            fclose(journal);
+            journal = nullptr;
+        }
+        journalSize = 0;
+    }
+
+    if (journalRead) {
+        int applied = 0;
+        const qint64 end = applyJournalRecords(data, 0, reload ? nullptr : &foreign, applied) + start;
+        if (end < start + data.size()) {
+            // Left by an instance that crashed while appending
+            blog(LOG_WARNING, "Dropped %lld bytes of incomplete dock layout journal records",
+                 start + qint64(data.size()) - end);
+            if (!QFile::resize(journalPath, end))
+                compactRequested = true;
+        }
+        journalSize = end;
+        if (!reload)
+            Diagnostics::addToCounter(Diagnostics::Counter::ForeignChanges, applied);
+
+        if (!journal)
+            journal = os_fopen(journalPath.toUtf8().constData(), "ab");
+    } else {
+        // Lost or shorter than what was written; the next write puts the
+        // whole state of this instance into a new database
+        compactRequested = true;
+    }
+
+    // This instance's changes go on top, including those made while the
+    // files were read, which stay pending for the next write
+    QSet<QString> own;
+    for (const QVector<QByteArray> *list : {&records, &pendingRecords}) {
+        for (const QByteArray &record : *list)
+            applyJournalRecord(reinterpret_cast<const uchar *>(record.constData()), quint32(record.size()), &own);
+    }
+
+    if (!reload) {
+        const int conflicts = int(own.intersect(foreign).size());
+        if (conflicts > 0) {
+            Diagnostics::addToCounter(Diagnostics::Counter::WriteConflicts, conflicts);
+            blog(LOG_WARNING, "%d dock layouts were also changed by another instance, keeping the changes made here",
+                 conflicts);
+        }
+    }
+
+    announceForeignChanges(before, defaultBefore, foreign);
+}
+
+// Writer thread only, with the mutex held. The signals are emitted on the UI
+// thread, like those of local changes.
+void LayoutStore::announceForeignChanges(const Layouts &before, const QString &defaultBefore,
+                                         const QSet<QString> &names)
+{
+    QStringList added, changed, removed;
+    for (const QString &name : names) {
+        const bool existed = before.contains(name);
+        const bool exists = layouts.contains(name);
+        if (existed && exists)
+            changed.append(name);
+        else if (exists)
+            added.append(name);
+        else if (existed)
+            removed.append(name);
+    }
+
+    const QString defaultAfter = settings.value(defaultLayoutKey);
+    const bool defaultChanged = defaultAfter != defaultBefore;
+    if (added.isEmpty() && changed.isEmpty() && removed.isEmpty() && !defaultChanged)
+        return;
+
+    blog(LOG_INFO, "Picked up dock layout changes from another instance: %d added, %d changed, %d removed",
+         int(added.size()), int(changed.size()), int(removed.size()));
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, added, changed, removed, defaultChanged, defaultAfter]() {
+            for (const QString &name : removed)
+                emit layoutRemoved(name);
+            for (const QString &name : added)
+                emit layoutAdded(name);
+            for (const QString &name : changed)
+                emit layoutChanged(name);
+            if (defaultChanged)
+                emit defaultLayoutChanged(defaultAfter);
+        },
+        Qt::QueuedConnection);
+}
+
+LayoutStore::Stats LayoutStore::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return computeStats();
+}
+
+// Must be called with the mutex held
+LayoutStore::Stats LayoutStore::computeStats() const
+{
+    Stats result;
+    result.layouts = int(layouts.size());
+    result.chunks = int(chunks.size());
+    for (const ChunkRef &chunk : chunks)
+        result.storedBytes += chunk.storedSize;
+
+    for (const LayoutValues &values : layouts) {
+        for (const StoredValue &value : values) {
+            if (value.mapped) {
+                result.logicalBytes += value.size;
+            } else {
+                // Not written yet, so not deduplicated yet either
+                result.logicalBytes += value.data.size();
+                result.storedBytes += value.data.size();
+            }
+        }
+    }
+
+    return result;
+}
+
+void LayoutStore::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (;;) {
+        writerWake.wait(lock, [this] { return stopping || syncRequested || revision != writtenRevision; });
+        if (revision == writtenRevision && !syncRequested)
+            break; // Stopping with nothing left to write
+
+        // Let a burst of changes settle so they end up in a single write
+        if (!stopping && flushWaiters == 0)
+            writerWake.wait_for(lock, writeCoalesceDelay, [this] { return stopping || flushWaiters > 0; });
+
+        // Most notifications are about this instance's own writes
+        if (revision == writtenRevision && !sharedFilesChanged()) {
+            syncRequested = false;
+            continue;
+        }
+
+        // Writers of other instances go one at a time
+        const bool locked = lockShared(lock);
+        if (!locked) {
+            Diagnostics::addToCounter(Diagnostics::Counter::LockTimeouts, 1);
+            if (!stopping) {
+                blog(LOG_WARNING, "Dock layout database '%s' is locked by another instance, retrying",
+                     filePath.toUtf8().constData());
+                syncRequested = true;
+                continue;
+            }
+            blog(LOG_WARNING, "Dock layout database '%s' is locked by another instance, writing anyway",
+                 filePath.toUtf8().constData());
+        }
+
+        uint64_t snapshotRevision = revision;
+        QVector<QByteArray> records;
+        records.swap(pendingRecords);
+        syncRequested = false;
+
+        if (locked)
+            catchUp(lock, records);
+
+        // A burst bigger than the journal threshold, e.g. an import, goes
+        // straight into a rewrite. Picking up other instances' changes
+        // alone writes nothing.
+        qint64 recordBytes = 0;
+        for (const QByteArray &record : records)
+            recordBytes += record.size();
+        bool compact = compactRequested ||
+                       (!records.isEmpty() && (!journal || journalSize + recordBytes >= journalCompactBytes));
+        if (!compact) {
+            // Only the changes themselves are written
+            lock.unlock();
+            QElapsedTimer syncTimer;
+            syncTimer.start();
+            const bool appended = appendJournal(records);
+            lock.lock();
+
+            if (appended) {
+                Diagnostics::record(Diagnostics::Phase::DiskSync, syncTimer.nsecsElapsed());
+            } else {
+                blog(LOG_WARNING, "Failed to append to dock layout journal '%s', rewriting the database instead",
+                     journalPath.toUtf8().constData());
+                compact = true;
+            }
+        }
+
+        if (compact)
+            compactDatabase(lock, records, snapshotRevision);
+
+        if (locked)
+            sharedLock->unlock();
+
+        // A failed write is logged, not retried, so flush() never hangs
+        writtenRevision = snapshotRevision;
+        writerDone.notify_all();
+    }
+}
+
+// Must be called with the mutex held. Rewrites the database from memory and
+// starts an empty journal; records are the changes not journaled yet, which
+// are appended to the old journal if the database cannot be replaced.
+void LayoutStore::compactDatabase(std::unique_lock<std::mutex> &lock, QVector<QByteArray> &records,
+                                  uint64_t &snapshotRevision)
+{
+    // The snapshot covers every change so far, journaled or not
+    snapshotRevision = revision;
+    records += pendingRecords;
+    pendingRecords.clear();
+
+    // Qt containers are implicitly shared, so these copies are cheap;
+    // the UI thread detaches on its next mutation
+    Snapshot snapshot;
+    snapshot.layouts = layouts;
+    snapshot.settings = settings;
+    snapshot.chunks = chunks;
+    snapshot.source = mapping;
+    snapshot.generation = generation + 1;
+    const QString path = filePath;
+
+    lock.unlock();
+    QElapsedTimer syncTimer;
+    syncTimer.start();
+    QSaveFile target(path);
+    WriteResult result;
+    const bool written = writeDatabase(target, snapshot, result);
+    lock.lock();
+
+    bool committed = false;
+    if (!written) {
+        blog(LOG_WARNING, "Failed to write dock layouts to '%s': %s", path.toUtf8().constData(),
+             target.errorString().toUtf8().constData());
+    } else {
+        // Windows refuses to replace a file that is still mapped. Readers
+        // only touch the mapping under the mutex, so it is safe to drop.
+        snapshot.source.reset();
+        mapping.reset();
+
+        committed = target.commit();
+        if (!committed)
+            blog(LOG_WARNING, "Failed to save dock layouts to '%s': %s", path.toUtf8().constData(),
+                 target.errorString().toUtf8().constData());
+
+        // Map whichever file is now on disk
+        mapping = mapFile(path);
+        if (committed) {
+            generation = snapshot.generation;
+            applyWriteResult(snapshot, result);
+        }
+        if (!mapping && !layouts.isEmpty())
+            blog(LOG_ERROR, "Failed to map dock layout database '%s'", path.toUtf8().constData());
+    }
+
+    lock.unlock();
+    bool journaled;
+    if (committed) {
+        // Everything in the old journal is part of the new database now
+        journaled = resetJournal(snapshot.generation);
+        if (!journaled)
+            blog(LOG_WARNING, "Failed to reset dock layout journal '%s', every change rewrites the database",
+                 journalPath.toUtf8().constData());
+    } else {
+        // Keep the changes in the journal that matches the old database
+        journaled = appendJournal(records);
+    }
+    lock.lock();
+
+    Diagnostics::record(Diagnostics::Phase::DiskSync, syncTimer.nsecsElapsed());
+
+    // A failed rewrite is tried again with the next change
+    compactRequested = !committed;
+    if (!committed && !journaled && !records.isEmpty())
+        blog(LOG_ERROR, "%d dock layout changes could not be written to disk", int(records.size()));
+}
+
+// Must be called with the mutex held, after the new file was committed
+void LayoutStore::applyWriteResult(const Snapshot &snapshot, WriteResult &result)
+{
+    chunks = std::move(result.chunks);
+
+    for (auto layout = layouts.begin(); layout != layouts.end(); ++layout) {
+        const auto written = result.ownedChunks.constFind(layout.key());
+        const auto snapshotLayout = snapshot.layouts.constFind(layout.key());
+
+        for (auto value = layout->begin(); value != layout->end(); ++value) {
+            if (value->mapped) {
+                // Unchanged since the snapshot; the chunks only moved
+                for (quint32 &id : value->chunks)
+                    id = quint32(result.relocations[int(id)]);
+                continue;
+            }
+
+            // Hand values that were written and not touched since back to
+            // the mapping, so their bytes no longer live in memory
+            if (written == result.ownedChunks.constEnd() || snapshotLayout == snapshot.layouts.constEnd())
+                continue;
+            const auto writtenChunks = written->constFind(value.key());
+            const auto snapshotValue = snapshotLayout->constFind(value.key());
+            if (writtenChunks == written->constEnd() || snapshotValue == snapshotLayout->constEnd() ||
+                !value->data.isSharedWith(snapshotValue->data))
+                continue;
+
+            value->size = quint32(value->data.size());
+            value->data.clear();
+            value->chunks = *writtenChunks;
+            value->mapped = true;
+        }
+    }
+}
+
+bool LayoutStore::writeDatabase(QSaveFile &target, const Snapshot &snapshot, WriteResult &result)
+{
+    if (!target.open(QIODevice::WriteOnly))
+        return false;
+
+    const bool compress = snapshot.settings.value(compressLayoutsKey) != QStringLiteral("false");
+    const MappedFile *source = snapshot.source.get();
+
+    // New chunk table: every chunk still referenced plus the chunks of new
+    // values, each stored once no matter how many values contain it
+    QVector<ChunkRef> &table = result.chunks;
+    QVector<qint32> sourceIds;       // Old chunk copied into each new slot, or -1
+    QVector<QByteArray> pendingData; // Stored bytes of chunks that are new
+    QHash<QByteArray, quint32> idsByHash;
+    result.relocations.fill(-1, snapshot.chunks.size());
+
+    auto keepChunk = [&](quint32 oldId) -> quint32 {
+        qint32 &relocated = result.relocations[int(oldId)];
+        if (relocated < 0) {
+            const ChunkRef &chunk = snapshot.chunks[int(oldId)];
+            auto existing = idsByHash.constFind(chunk.hash);
+            if (existing != idsByHash.constEnd()) {
+                relocated = qint32(*existing);
+            } else {
+                relocated = qint32(table.size());
+                idsByHash.insert(chunk.hash, quint32(relocated));
+                table.append(chunk);
+                sourceIds.append(qint32(oldId));
+                pendingData.append(QByteArray());
+            }
+        }
+        return quint32(relocated);
+    };
+
+    auto addChunk = [&](const char *data, int size) -> quint32 {
+        ChunkRef chunk;
+        chunk.hash = LayoutChunker::hash(data, size);
+        auto existing = idsByHash.constFind(chunk.hash);
+        if (existing != idsByHash.constEnd())
+            return *existing;
+
+        QByteArray stored(data, size);
+        chunk.codec = CodecRaw;
+        if (compress) {
+            // Only worth it when it saves a noticeable share of the chunk
+            QByteArray packed = qCompress(stored);
+            if (packed.size() < stored.size() - stored.size() / 8) {
+                stored = packed;
+                chunk.codec = CodecZlib;
+            }
+        }
+        chunk.rawSize = quint32(size);
+        chunk.storedSize = quint32(stored.size());
+
+        const quint32 id = quint32(table.size());
+        idsByHash.insert(chunk.hash, id);
+        table.append(chunk);
+        sourceIds.append(-1);
+        pendingData.append(stored);
+        return id;
+    };
+
+    QStringList names = snapshot.layouts.keys();
+    names.sort();
+
+    // Chunk lists in the same order the index is written
+    QVector<QVector<quint32>> valueChunks;
+    QVector<quint32> valueSizes;
+    for (const QString &name : names) {
+        const LayoutValues &values = *snapshot.layouts.constFind(name);
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            QVector<quint32> ids;
+            if (it->mapped) {
+                if (!source)
+                    return false;
+                ids.reserve(it->chunks.size());
+                for (quint32 oldId : it->chunks)
+                    ids.append(keepChunk(oldId));
+                valueSizes.append(it->size);
+            } else {
+                int start = 0;
+                for (int end : LayoutChunker::split(it->data)) {
+                    ids.append(addChunk(it->data.constData() + start, end - start));
+                    start = end;
+                }
+                valueSizes.append(quint32(it->data.size()));
+                result.ownedChunks[name].insert(it.key(), ids);
+            }
+            valueChunks.append(ids);
+        }
+    }
+
+    QByteArray head;
+    head.append(databaseMagic, sizeof(databaseMagic));
+    appendU32(head, databaseVersion);
+    appendU64(head, snapshot.generation);
+    appendU32(head, quint32(snapshot.settings.size()));
+    appendU32(head, quint32(names.size()));
+    appendU32(head, quint32(table.size()));
+
+    for (auto it = snapshot.settings.constBegin(); it != snapshot.settings.constEnd(); ++it) {
+        appendString(head, it.key());
+        appendString(head, it.value());
+    }
+
+    quint64 blobOffset = 0;
+    QVector<quint64> sourceOffsets;
+    sourceOffsets.reserve(table.size());
+    for (ChunkRef &chunk : table) {
+        sourceOffsets.append(chunk.offset);
+        head.append(chunk.hash);
+        appendU64(head, blobOffset);
+        appendU32(head, chunk.storedSize);
+        appendU32(head, chunk.rawSize);
+        head.append(char(chunk.codec));
+        chunk.offset = blobOffset;
+        blobOffset += chunk.storedSize;
+    }
+
+    int valueIndex = 0;
+    for (const QString &name : names) {
+        const LayoutValues &values = *snapshot.layouts.constFind(name);
+        appendString(head, name);
+        appendU32(head, quint32(values.size()));
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it, ++valueIndex) {
+            appendString(head, it.key());
+            appendU32(head, valueSizes[valueIndex]);
+            appendU32(head, quint32(valueChunks[valueIndex].size()));
+            for (quint32 id : valueChunks[valueIndex])
+                appendU32(head, id);
+        }
+    }
+
+    if (target.write(head) != head.size())
+        return false;
+
+    // Chunk bytes are streamed straight from the old mapping or from memory
+    const quint64 blobBase = quint64(head.size());
+    for (int i = 0; i < table.size(); ++i) {
+        ChunkRef &chunk = table[i];
+        const char *bytes = sourceIds[i] >= 0 ? reinterpret_cast<const char *>(source->data + sourceOffsets[i])
+                                              : pendingData[i].constData();
+        if (target.write(bytes, chunk.storedSize) != qint64(chunk.storedSize))
+            return false;
+        chunk.offset += blobBase;
+    }
+
+    return true;
+}
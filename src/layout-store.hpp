@@ -0,0 +1,242 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QLockFile>
+#include <QMap>
+#include <QObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Process-wide, in-memory index of the layout database.
+//
+// The database is a versioned binary file (see layout-store.cpp for the
+// format) that is memory-mapped read-only: load() only parses the header and
+// the indexes, and a read only touches the chunks of the value it asks for.
+// Values are split into content-addressed chunks, so layouts that differ by a
+// few dock sizes share most of their bytes on disk.
+// Every mutation only updates memory and queues a journal record. A
+// background writer appends the queued records to the journal next to the
+// database, and once the journal grows past a threshold, compacts it by
+// rewriting the database and starting an empty journal.
+// Several OBS instances can share the files: writers take a lock file, and
+// before writing, or when the files change on disk, the writer applies the
+// records other instances appended (or reloads the database they compacted)
+// and announces only the layouts that changed.
+// Mutations are made on the UI thread and announced through the signals.
+class LayoutStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        int layouts = 0;
+        int chunks = 0;
+        qint64 logicalBytes = 0; // Sum of all value sizes
+        qint64 storedBytes = 0;  // Bytes the values actually occupy
+
+        double dedupRatio() const { return storedBytes > 0 ? double(logicalBytes) / double(storedBytes) : 1.0; }
+    };
+
+    static LayoutStore &instance();
+
+    ~LayoutStore();
+
+    // Opens the database, migrating legacyIniPath into it if the database
+    // does not exist yet
+    void load(const QString &databasePath, const QString &legacyIniPath);
+
+    // Blocks until every mutation made so far has been written to disk
+    void flush();
+
+    // Flushes and stops the writer thread; called from obs_module_unload
+    void shutdown();
+
+    // Writes every layout to a human-readable INI file
+    bool exportIni(const QString &iniPath) const;
+
+    QStringList layoutNames() const;
+    bool contains(const QString &name) const;
+
+    // With a screen key (see ScreenConfig), the variant saved for that
+    // monitor arrangement, or else the state saved last on any screens
+    QByteArray windowState(const QString &name, const QString &screenKey = QString()) const;
+    void setWindowState(const QString &name, const QByteArray &windowState, const QString &screenKey = QString());
+    bool hasWindowStateVariant(const QString &name, const QString &screenKey) const;
+
+    // Any other per-layout key, e.g. "Hotkey"
+    QByteArray value(const QString &name, const QString &key) const;
+    void setValue(const QString &name, const QString &key, const QByteArray &value);
+
+    // Every key of a layout at once, e.g. for export
+    QMap<QString, QByteArray> values(const QString &name) const;
+
+    // Adds whole layouts under a single lock, replacing layouts of the same
+    // name, and announces the whole batch with one layoutsReset(). Meant for
+    // imports.
+    using LayoutBatch = QVector<QPair<QString, QMap<QString, QByteArray>>>;
+    void setLayouts(const LayoutBatch &batch);
+
+    bool renameLayout(const QString &oldName, const QString &newName);
+    void removeLayout(const QString &name);
+
+    QString defaultLayout() const;
+    void setDefaultLayout(const QString &name);
+
+    // Plugin-wide options, kept next to DefaultLayout
+    QString setting(const QString &key) const;
+    void setSetting(const QString &key, const QString &value);
+
+    Stats stats() const;
+
+signals:
+    void layoutAdded(const QString &name);
+    void layoutChanged(const QString &name);
+    void layoutRemoved(const QString &name);
+    void layoutRenamed(const QString &oldName, const QString &newName);
+    void defaultLayoutChanged(const QString &name);
+
+    // Layouts added or replaced by setLayouts(), instead of a layoutAdded()
+    // or layoutChanged() per layout
+    void layoutsReset(const QStringList &names);
+
+private:
+    // Read-only mapping of the database file
+    struct MappedFile {
+        QFile file;
+        const uchar *data = nullptr;
+        qint64 size = 0;
+
+        ~MappedFile();
+    };
+
+    // A deduplicated, possibly compressed piece of one or more values
+    struct ChunkRef {
+        QByteArray hash;
+        quint64 offset = 0; // Absolute, into the mapped file
+        quint32 storedSize = 0;
+        quint32 rawSize = 0;
+        quint8 codec = 0;
+    };
+
+    // Either owned bytes (new or modified since the last write) or a list
+    // of chunks inside the mapped file
+    struct StoredValue {
+        QByteArray data;
+        QVector<quint32> chunks;
+        quint32 size = 0;
+        bool mapped = false;
+    };
+
+    // Keys of a layout (e.g. "WindowState"), kept as raw values so that keys
+    // this version does not know about survive a rewrite
+    using LayoutValues = QMap<QString, StoredValue>;
+    using Layouts = QHash<QString, LayoutValues>;
+
+    // Everything the writer needs, copied under the mutex
+    struct Snapshot {
+        Layouts layouts;
+        QMap<QString, QString> settings;
+        QVector<ChunkRef> chunks;
+        std::shared_ptr<MappedFile> source;
+        quint64 generation = 0;
+    };
+
+    // What the writer produced, applied back under the mutex after commit
+    struct WriteResult {
+        QVector<ChunkRef> chunks;
+        QVector<qint32> relocations; // Old chunk id -> new chunk id
+        QHash<QString, QHash<QString, QVector<quint32>>> ownedChunks;
+    };
+
+    // A database file mapped and indexed, before it replaces the current one
+    struct LoadedDatabase {
+        std::shared_ptr<MappedFile> mapping;
+        QVector<ChunkRef> chunks;
+        Layouts layouts;
+        QMap<QString, QString> settings;
+        quint64 generation = 0;
+        quint32 version = 0;
+    };
+
+    LayoutStore() = default;
+
+    static std::shared_ptr<MappedFile> mapFile(const QString &path);
+    Stats computeStats() const;
+    QByteArray valueBytes(const StoredValue &value) const;
+    bool openDatabase(const QString &path);
+    static bool readDatabase(const QString &path, LoadedDatabase &loaded);
+    void useDatabase(LoadedDatabase &loaded);
+    static bool readIndex(const MappedFile &mapped, quint32 version, Layouts &loadedLayouts,
+                          QMap<QString, QString> &loadedSettings, QVector<ChunkRef> &loadedChunks,
+                          quint64 &loadedGeneration);
+    bool migrateIni(const QString &iniPath);
+    void insertValue(const QString &name, const QString &key, const QByteArray &bytes);
+    bool replayJournal();
+    qint64 applyJournalRecords(const QByteArray &data, qint64 offset, QSet<QString> *touched, int &applied);
+    bool applyJournalRecord(const uchar *payload, quint32 size, QSet<QString> *touched = nullptr);
+    bool appendJournal(const QVector<QByteArray> &records);
+    bool resetJournal(quint64 journalGeneration);
+    void logMutation(const QByteArray &record);
+    void requestCompaction();
+    void markDirty();
+    void onSharedFileChanged();
+    bool lockShared(std::unique_lock<std::mutex> &lock);
+    bool sharedFilesChanged() const;
+    void catchUp(std::unique_lock<std::mutex> &lock, const QVector<QByteArray> &records);
+    void announceForeignChanges(const Layouts &before, const QString &defaultBefore, const QSet<QString> &names);
+    void writerLoop();
+    void compactDatabase(std::unique_lock<std::mutex> &lock, QVector<QByteArray> &records,
+                         uint64_t &snapshotRevision);
+    void applyWriteResult(const Snapshot &snapshot, WriteResult &result);
+    static bool writeDatabase(QSaveFile &target, const Snapshot &snapshot, WriteResult &result);
+
+    QString filePath;
+    QString journalPath;
+
+    mutable std::mutex mutex;
+    std::condition_variable writerWake;
+    std::condition_variable writerDone;
+    std::thread writer;
+    bool stopping = false;
+    int flushWaiters = 0;
+    uint64_t revision = 0;
+    uint64_t writtenRevision = 0;
+
+    // Changes not in the journal yet, and whether the next write has to
+    // rewrite the database (migrations, failed appends)
+    QVector<QByteArray> pendingRecords;
+    bool compactRequested = false;
+    bool syncRequested = false; // The shared files changed on disk
+
+    // Serializes writers across OBS instances; the watcher lives on the UI
+    // thread
+    std::unique_ptr<QLockFile> sharedLock;
+    QFileSystemWatcher watcher;
+
+    // Only touched by load(), the writer thread and shutdown()
+    FILE *journal = nullptr;
+    qint64 journalSize = 0;
+    quint64 generation = 0; // Of the database; the journal must match it
+
+    std::shared_ptr<MappedFile> mapping;
+    QVector<ChunkRef> chunks;
+    Layouts layouts;
+    QMap<QString, QString> settings;
+};
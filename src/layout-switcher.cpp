@@ -0,0 +1,271 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-switcher.hpp"
+
+#include <QDockWidget>
+#include <QHash>
+#include <QSet>
+
+#include <algorithm>
+
+using namespace WindowState;
+
+// Above this many changed docks a single restoreState() is cheaper
+static int maxIncrementalDocks(int dockCount)
+{
+    return std::max(4, dockCount / 3);
+}
+
+static bool sameStructure(const State &current, const State &target, QString &reason)
+{
+    if (current.trailer != target.trailer) {
+        reason = QStringLiteral("toolbars differ");
+        return false;
+    }
+
+    if (current.areas.size() != target.areas.size() ||
+        current.floatingWindows.size() != target.floatingWindows.size() ||
+        current.groups.size() != target.groups.size() || current.docks.size() != target.docks.size() ||
+        !std::equal(std::begin(current.corners), std::end(current.corners), std::begin(target.corners))) {
+        reason = QStringLiteral("dock areas differ");
+        return false;
+    }
+
+    for (int i = 0; i < current.areas.size(); ++i) {
+        if (current.areas[i].area != target.areas[i].area) {
+            reason = QStringLiteral("dock areas differ");
+            return false;
+        }
+    }
+
+    // Both states are parsed in stream order, so equal trees have equal indices
+    for (int i = 0; i < current.groups.size(); ++i) {
+        const Group &a = current.groups[i];
+        const Group &b = target.groups[i];
+        if (a.parent != b.parent || a.area != b.area || a.tabbed != b.tabbed || a.orientation != b.orientation ||
+            a.items.size() != b.items.size()) {
+            reason = QStringLiteral("dock groups differ");
+            return false;
+        }
+        for (int j = 0; j < a.items.size(); ++j) {
+            if (a.items[j].isGroup != b.items[j].isGroup || a.items[j].index != b.items[j].index) {
+                reason = QStringLiteral("dock groups differ");
+                return false;
+            }
+        }
+    }
+
+    for (int i = 0; i < current.docks.size(); ++i) {
+        if (current.docks[i].objectName != target.docks[i].objectName ||
+            current.docks[i].floating != target.docks[i].floating) {
+            reason = QStringLiteral("dock '%1' moved").arg(target.docks[i].objectName);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// A visible, docked dock directly inside the group whose resizeDocks()
+// along orientation resizes the group itself (or its area, for roots)
+static int anchorDock(const State &state, int groupIndex, Qt::Orientation orientation)
+{
+    const Group &group = state.groups[groupIndex];
+    if (!group.tabbed && group.orientation == orientation)
+        return -1;
+
+    for (const Group::Item &item : group.items) {
+        if (!item.isGroup && state.docks[item.index].visible && !state.docks[item.index].floating)
+            return item.index;
+    }
+    return -1;
+}
+
+static Qt::Orientation areaOrientation(qint32 area)
+{
+    return area == LeftArea || area == RightArea ? Qt::Horizontal : Qt::Vertical;
+}
+
+QStringList LayoutSwitcher::stripMissingDocks(QMainWindow *mainWindow, QByteArray &state)
+{
+    State parsed;
+    if (!parse(state, parsed))
+        return QStringList();
+
+    QSet<QString> present;
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>())
+        present.insert(dock->objectName());
+
+    // Qt would keep an empty placeholder for each of them, and the current
+    // state never has them, so no switch could be incremental
+    QSet<QString> missing;
+    for (const DockRecord &dock : parsed.docks) {
+        if (!present.contains(dock.objectName))
+            missing.insert(dock.objectName);
+    }
+    if (missing.isEmpty())
+        return QStringList();
+
+    removeDocks(parsed, missing);
+    state = serialize(parsed);
+
+    QStringList removed(missing.begin(), missing.end());
+    removed.sort();
+    return removed;
+}
+
+LayoutSwitcher::Plan LayoutSwitcher::plan(QMainWindow *mainWindow, const QByteArray &targetState)
+{
+    Plan result;
+    result.targetState = targetState;
+    result.missingDocks = stripMissingDocks(mainWindow, result.targetState);
+
+    State current, target;
+    if (!parse(result.targetState, target)) {
+        result.reason = QStringLiteral("target state is unreadable");
+        return result;
+    }
+
+    QHash<QString, QDockWidget *> docksByName;
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>())
+        docksByName.insert(dock->objectName(), dock);
+
+    if (!parse(mainWindow->saveState(), current)) {
+        result.reason = QStringLiteral("current state is unreadable");
+        return result;
+    }
+    if (!sameStructure(current, target, result.reason))
+        return result;
+
+    QVector<Change> hides, shows, moves, resizes, raises;
+    QVector<bool> dockChanged(target.docks.size(), false);
+
+    auto dockWidget = [&](int index) -> QDockWidget * {
+        dockChanged[index] = true;
+        return docksByName.value(target.docks[index].objectName);
+    };
+
+    for (int i = 0; i < target.docks.size(); ++i) {
+        const DockRecord &from = current.docks[i];
+        const DockRecord &to = target.docks[i];
+
+        if (from.visible != to.visible) {
+            Change change{to.visible ? Change::Show : Change::Hide, dockWidget(i)};
+            (to.visible ? shows : hides).append(change);
+        }
+
+        if (to.floating && from.geometry != to.geometry) {
+            Change change{Change::MoveFloating, dockWidget(i)};
+            change.geometry = to.geometry;
+            moves.append(change);
+        } else if (!to.floating && to.visible && from.size != to.size && to.tabGroup < 0) {
+            Change change{Change::Resize, dockWidget(i)};
+            change.size = to.size;
+            change.orientation = Qt::Orientation(target.groups[to.group].orientation);
+            resizes.append(change);
+        }
+    }
+
+    for (int i = 0; i < target.groups.size(); ++i) {
+        const Group &from = current.groups[i];
+        const Group &to = target.groups[i];
+
+        if (to.tabbed && from.currentTab != to.currentTab && to.currentTab >= 0 && to.currentTab < to.items.size() &&
+            !to.items[to.currentTab].isGroup) {
+            raises.append(Change{Change::RaiseTab, dockWidget(to.items[to.currentTab].index)});
+        }
+
+        if (to.parent >= 0 && from.size != to.size) {
+            const Qt::Orientation orientation = Qt::Orientation(target.groups[to.parent].orientation);
+            const int anchor = anchorDock(target, i, orientation);
+            if (anchor < 0) {
+                result.reason = QStringLiteral("nested splitter sizes differ");
+                return result;
+            }
+            Change change{Change::Resize, dockWidget(anchor)};
+            change.size = to.size;
+            change.orientation = orientation;
+            resizes.append(change);
+        }
+    }
+
+    for (int i = 0; i < target.areas.size(); ++i) {
+        const State::Area &to = target.areas[i];
+        const Qt::Orientation orientation = areaOrientation(to.area);
+        const int fromExtent = orientation == Qt::Horizontal ? current.areas[i].size.width()
+                                                             : current.areas[i].size.height();
+        const int toExtent = orientation == Qt::Horizontal ? to.size.width() : to.size.height();
+        if (fromExtent == toExtent)
+            continue;
+
+        const int anchor = anchorDock(target, to.group, orientation);
+        if (anchor < 0) {
+            result.reason = QStringLiteral("dock area sizes differ");
+            return result;
+        }
+        Change change{Change::Resize, dockWidget(anchor)};
+        change.size = toExtent;
+        change.orientation = orientation;
+        resizes.append(change);
+    }
+
+    for (int i = 0; i < target.floatingWindows.size(); ++i) {
+        if (current.floatingWindows[i].geometry != target.floatingWindows[i].geometry) {
+            result.reason = QStringLiteral("floating tab groups moved");
+            return result;
+        }
+    }
+
+    result.changedDocks = int(std::count(dockChanged.begin(), dockChanged.end(), true));
+    if (result.changedDocks > maxIncrementalDocks(int(target.docks.size()))) {
+        result.reason = QStringLiteral("%1 docks changed").arg(result.changedDocks);
+        return result;
+    }
+
+    // Hiding first frees space, so the resizes that follow are final
+    result.changes = hides + shows + moves + resizes + raises;
+    for (const Change &change : result.changes) {
+        if (!change.dock) {
+            result.reason = QStringLiteral("a changed dock does not exist");
+            result.changes.clear();
+            return result;
+        }
+    }
+
+    result.fullRestore = false;
+    return result;
+}
+
+void LayoutSwitcher::applyChange(QMainWindow *mainWindow, const Change &change)
+{
+    if (!change.dock)
+        return;
+
+    switch (change.kind) {
+    case Change::Show:
+        change.dock->show();
+        break;
+    case Change::Hide:
+        change.dock->hide();
+        break;
+    case Change::MoveFloating:
+        change.dock->setGeometry(change.geometry);
+        break;
+    case Change::Resize:
+        mainWindow->resizeDocks({change.dock.data()}, {change.size}, change.orientation);
+        break;
+    case Change::RaiseTab:
+        change.dock->raise();
+        break;
+    case Change::Dock:
+        change.dock->setFloating(false);
+        mainWindow->addDockWidget(change.area, change.dock);
+        break;
+    case Change::Float:
+        change.dock->setFloating(true);
+        change.dock->setGeometry(change.geometry);
+        break;
+    }
+}
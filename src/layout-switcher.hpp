@@ -0,0 +1,67 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include "window-state.hpp"
+
+#include <QByteArray>
+#include <QMainWindow>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QDockWidget;
+
+// Switches the main window to a saved layout by touching only the docks
+// that differ from the current state.
+//
+// When both states have the same dock tree (same docks in the same areas,
+// groups and tabs) the switch is reduced to visibility, floating geometry,
+// splitter size and current-tab changes. Anything else, or a diff touching
+// too many docks, falls back to a full QMainWindow::restoreState().
+// Docks the target names but the window does not have, such as those of
+// plugins that are not installed, are left out of the target first.
+// RestoreScheduler applies the plans.
+namespace LayoutSwitcher {
+
+struct Change {
+    enum Kind {
+        Show,
+        Hide,
+        MoveFloating, // Set the floating window geometry
+        Resize,       // resizeDocks() along orientation
+        RaiseTab,
+        Dock,  // Move into area, docking it if it floats
+        Float, // Make floating at geometry
+    };
+
+    Kind kind;
+    QPointer<QDockWidget> dock;
+    QRect geometry;
+    int size = 0;
+    Qt::Orientation orientation = Qt::Horizontal;
+    Qt::DockWidgetArea area = Qt::LeftDockWidgetArea;
+};
+
+struct Plan {
+    QByteArray targetState;
+    bool fullRestore = true;
+    QString reason; // Why a full restore is needed
+    QVector<Change> changes;
+    int changedDocks = 0;
+    QStringList missingDocks; // Left out of targetState, they do not exist
+};
+
+Plan plan(QMainWindow *mainWindow, const QByteArray &targetState);
+
+// Removes the docks the main window does not have from state and returns
+// their names, sorted. An unreadable state is left as it is.
+QStringList stripMissingDocks(QMainWindow *mainWindow, QByteArray &state);
+
+// Applies a single step of an incremental plan
+void applyChange(QMainWindow *mainWindow, const Change &change);
+
+} // namespace LayoutSwitcher
@@ -0,0 +1,332 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-thumbnails.hpp"
+#include "layout-chunker.hpp"
+#include "layout-store.hpp"
+#include "screen-config.hpp"
+#include "window-state.hpp"
+
+#include <obs-module.h>
+
+#include <QDir>
+#include <QPainter>
+#include <QSaveFile>
+
+using WindowState::DockRecord;
+using WindowState::Group;
+using WindowState::State;
+
+// Bumped whenever the drawing changes, so older files are not picked up
+static constexpr int rendererVersion = 1;
+
+// About two hundred thumbnails
+static constexpr int memoryCacheKb = 4096;
+
+static const QColor backgroundColor(0x1e, 0x1f, 0x22);
+static const QColor centralColor(0x3a, 0x3c, 0x42);
+
+static bool dock_shown(const DockRecord &dock)
+{
+    return dock.visible && !dock.floating;
+}
+
+static bool group_shown(const State &state, qint32 groupIndex)
+{
+    for (const Group::Item &item : state.groups[groupIndex].items) {
+        if (item.isGroup ? group_shown(state, item.index) : dock_shown(state.docks[item.index]))
+            return true;
+    }
+    return false;
+}
+
+static void paint_dock(QPainter &painter, const DockRecord &dock, const QRectF &rect, bool tabbed)
+{
+    // The same dock keeps its color in every layout
+    const QColor color = QColor::fromHsv(int(qHash(dock.objectName) % 360), 80, 200);
+    const QRectF inner = rect.adjusted(0.5, 0.5, -0.5, -0.5);
+
+    painter.setPen(color.darker(170));
+    painter.setBrush(color);
+    painter.drawRect(inner);
+
+    // A darker strip along the top marks a tab group
+    if (tabbed)
+        painter.fillRect(QRectF(inner.left(), inner.top(), inner.width(), qMin(3.0, inner.height() / 3)),
+                         color.darker(130));
+}
+
+static void paint_group(QPainter &painter, const State &state, qint32 groupIndex, const QRectF &rect)
+{
+    const Group &group = state.groups[groupIndex];
+
+    if (group.tabbed) {
+        // Only the current tab shows, or the first one that is visible
+        const DockRecord *shown = nullptr;
+        for (int i = 0; i < group.items.size(); ++i) {
+            const Group::Item &item = group.items[i];
+            if (item.isGroup || !dock_shown(state.docks[item.index]))
+                continue;
+            if (!shown || i == group.currentTab)
+                shown = &state.docks[item.index];
+        }
+        if (shown)
+            paint_dock(painter, *shown, rect, true);
+        return;
+    }
+
+    // Sizes are shares of the splitter; positions would also count handles
+    QVector<Group::Item> items;
+    qint64 total = 0;
+    for (const Group::Item &item : group.items) {
+        if (item.isGroup ? !group_shown(state, item.index) : !dock_shown(state.docks[item.index]))
+            continue;
+        items.append(item);
+        total += qMax(1, item.isGroup ? state.groups[item.index].size : state.docks[item.index].size);
+    }
+
+    const bool horizontal = group.orientation == Qt::Horizontal;
+    qreal offset = horizontal ? rect.left() : rect.top();
+    const qreal extent = horizontal ? rect.width() : rect.height();
+
+    for (const Group::Item &item : items) {
+        const int size = qMax(1, item.isGroup ? state.groups[item.index].size : state.docks[item.index].size);
+        const qreal length = extent * size / total;
+        const QRectF part = horizontal ? QRectF(offset, rect.top(), length, rect.height())
+                                       : QRectF(rect.left(), offset, rect.width(), length);
+        offset += length;
+
+        if (item.isGroup)
+            paint_group(painter, state, item.index, part);
+        else
+            paint_dock(painter, state.docks[item.index], part, false);
+    }
+}
+
+// Floating docks are left out; their geometry is in screen coordinates
+static QImage render_thumbnail(const State &state)
+{
+    QImage image(LayoutThumbnails::thumbnailSize(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    // Extent of each dock area that has something visible in it
+    qint32 extents[4] = {};
+    qint32 groups[4] = {-1, -1, -1, -1};
+    for (const State::Area &area : state.areas) {
+        if (area.area < WindowState::LeftArea || area.area > WindowState::BottomArea || !group_shown(state, area.group))
+            continue;
+        const bool vertical = area.area == WindowState::LeftArea || area.area == WindowState::RightArea;
+        extents[area.area] = qMax(0, vertical ? area.size.width() : area.size.height());
+        groups[area.area] = area.group;
+    }
+
+    const qreal left = extents[WindowState::LeftArea];
+    const qreal right = extents[WindowState::RightArea];
+    const qreal top = extents[WindowState::TopArea];
+    const qreal bottom = extents[WindowState::BottomArea];
+    const qreal width = left + qMax(0, state.centralSize.width()) + right;
+    const qreal height = top + qMax(0, state.centralSize.height()) + bottom;
+    if (width <= 0 || height <= 0)
+        return image;
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, false);
+
+    // Fit the main window into the thumbnail, keeping its aspect ratio
+    const qreal scale = qMin(image.width() / width, image.height() / height);
+    painter.translate((image.width() - width * scale) / 2, (image.height() - height * scale) / 2);
+    painter.scale(scale, scale);
+    painter.fillRect(QRectF(0, 0, width, height), backgroundColor);
+    painter.fillRect(QRectF(left, top, width - left - right, height - top - bottom), centralColor);
+
+    // Corners are given to the side areas or to the top and bottom ones
+    const bool leftTop = state.corners[0] == Qt::LeftDockWidgetArea;
+    const bool rightTop = state.corners[1] == Qt::RightDockWidgetArea;
+    const bool leftBottom = state.corners[2] == Qt::LeftDockWidgetArea;
+    const bool rightBottom = state.corners[3] == Qt::RightDockWidgetArea;
+
+    QRectF rects[4];
+    rects[WindowState::LeftArea] = QRectF(0, leftTop ? 0 : top, left,
+                                          height - (leftTop ? 0 : top) - (leftBottom ? 0 : bottom));
+    rects[WindowState::RightArea] = QRectF(width - right, rightTop ? 0 : top, right,
+                                           height - (rightTop ? 0 : top) - (rightBottom ? 0 : bottom));
+    rects[WindowState::TopArea] = QRectF(leftTop ? left : 0, 0,
+                                         width - (leftTop ? left : 0) - (rightTop ? right : 0), top);
+    rects[WindowState::BottomArea] = QRectF(leftBottom ? left : 0, height - bottom,
+                                            width - (leftBottom ? left : 0) - (rightBottom ? right : 0), bottom);
+
+    for (int area = WindowState::LeftArea; area <= WindowState::BottomArea; ++area) {
+        if (groups[area] >= 0 && !rects[area].isEmpty())
+            paint_group(painter, state, groups[area], rects[area]);
+    }
+
+    return image;
+}
+
+// Worker thread
+static QImage load_or_render(const QString &layoutName, const QString &screenKey, const QString &cacheDirectory)
+{
+    const QByteArray windowState = LayoutStore::instance().windowState(layoutName, screenKey);
+    if (windowState.isEmpty())
+        return QImage();
+
+    QString path;
+    if (!cacheDirectory.isEmpty()) {
+        const QByteArray hash = LayoutChunker::hash(windowState.constData(), int(windowState.size()));
+        path = QStringLiteral("%1/%2-%3.png")
+                   .arg(cacheDirectory, QString::fromLatin1(hash.toHex()))
+                   .arg(rendererVersion);
+
+        QImage cached;
+        if (cached.load(path, "PNG") && cached.size() == LayoutThumbnails::thumbnailSize())
+            return cached.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    State state;
+    if (!WindowState::parse(windowState, state))
+        return QImage();
+
+    QImage image = render_thumbnail(state);
+    if (!path.isEmpty()) {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || !image.save(&file, "PNG") || !file.commit())
+            blog(LOG_DEBUG, "Failed to cache the thumbnail of dock layout '%s'", layoutName.toUtf8().constData());
+    }
+    return image;
+}
+
+// Worker thread. Deletes the files of older renderers and of states that no
+// layout has any more, so the cache does not grow with every edit.
+static void prune_cache(const QString &cacheDirectory)
+{
+    LayoutStore &store = LayoutStore::instance();
+    QSet<QString> hashes;
+    for (const QString &name : store.layoutNames()) {
+        const QMap<QString, QByteArray> values = store.values(name);
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            if (it.key() == QLatin1String("WindowState") || it.key().startsWith(QLatin1String("WindowState@")))
+                hashes.insert(QString::fromLatin1(LayoutChunker::hash(it->constData(), int(it->size())).toHex()));
+        }
+    }
+
+    const QString suffix = QStringLiteral("-%1.png").arg(rendererVersion);
+    int removed = 0;
+    for (const QFileInfo &file : QDir(cacheDirectory).entryInfoList({QStringLiteral("*.png")}, QDir::Files)) {
+        const QString fileName = file.fileName();
+        if (fileName.endsWith(suffix) && hashes.contains(fileName.left(fileName.size() - suffix.size())))
+            continue;
+        if (QFile::remove(file.filePath()))
+            ++removed;
+    }
+    if (removed > 0)
+        blog(LOG_INFO, "Removed %d stale dock layout thumbnails", removed);
+}
+
+LayoutThumbnails &LayoutThumbnails::instance()
+{
+    static LayoutThumbnails thumbnails;
+    return thumbnails;
+}
+
+LayoutThumbnails::LayoutThumbnails()
+{
+    // One thread is plenty and never competes with OBS's own work
+    pool.setMaxThreadCount(1);
+    images.setMaxCost(memoryCacheKb);
+
+    blank = QImage(thumbnailSize(), QImage::Format_ARGB32_Premultiplied);
+    blank.fill(Qt::transparent);
+
+    LayoutStore &store = LayoutStore::instance();
+    connect(&store, &LayoutStore::layoutChanged, this, &LayoutThumbnails::drop);
+    connect(&store, &LayoutStore::layoutRemoved, this, &LayoutThumbnails::drop);
+    connect(&store, &LayoutStore::layoutsReset, this, [this](const QStringList &names) {
+        for (const QString &name : names)
+            drop(name);
+    });
+    connect(&store, &LayoutStore::layoutRenamed, this, &LayoutThumbnails::onLayoutRenamed);
+
+    // Thumbnails show the variant for the current screens
+    connect(&ScreenConfig::instance(), &ScreenConfig::changed, this, &LayoutThumbnails::dropAll);
+}
+
+void LayoutThumbnails::setCacheDirectory(const QString &path)
+{
+    if (!QDir().mkpath(path)) {
+        blog(LOG_WARNING, "Failed to create the thumbnail cache %s", path.toUtf8().constData());
+        return;
+    }
+    cacheDirectory = path;
+
+    // Runs before any render, which share the single worker
+    pool.start([path]() { prune_cache(path); });
+}
+
+void LayoutThumbnails::shutdown()
+{
+    pool.clear();
+    pool.waitForDone();
+    pending.clear();
+}
+
+QImage LayoutThumbnails::thumbnail(const QString &layoutName)
+{
+    if (const QImage *image = images.object(layoutName))
+        return *image;
+
+    if (!pending.contains(layoutName))
+        requestRender(layoutName);
+    return blank;
+}
+
+void LayoutThumbnails::requestRender(const QString &layoutName)
+{
+    const quint64 ticket = ++nextTicket;
+    pending.insert(layoutName, ticket);
+
+    const QString screenKey = ScreenConfig::instance().currentKey();
+    const QString directory = cacheDirectory;
+    pool.start([this, layoutName, ticket, screenKey, directory]() {
+        QImage image = load_or_render(layoutName, screenKey, directory);
+        QMetaObject::invokeMethod(
+            this, [this, layoutName, ticket, image]() { onRendered(layoutName, ticket, image); },
+            Qt::QueuedConnection);
+    });
+}
+
+void LayoutThumbnails::onRendered(const QString &layoutName, quint64 ticket, const QImage &image)
+{
+    // The layout changed while this was rendering; the next paint asks again
+    auto found = pending.find(layoutName);
+    if (found == pending.end() || found.value() != ticket)
+        return;
+    pending.erase(found);
+
+    // Layouts that cannot be drawn stay blank instead of being retried
+    QImage *cached = new QImage(image.isNull() ? blank : image);
+    images.insert(layoutName, cached, qMax<qsizetype>(1, cached->sizeInBytes() / 1024));
+    emit thumbnailReady(layoutName);
+}
+
+void LayoutThumbnails::drop(const QString &layoutName)
+{
+    images.remove(layoutName);
+    pending.remove(layoutName);
+}
+
+void LayoutThumbnails::onLayoutRenamed(const QString &oldName, const QString &newName)
+{
+    drop(newName);
+    if (!pending.remove(oldName)) {
+        if (QImage *image = images.take(oldName))
+            images.insert(newName, image, qMax<qsizetype>(1, image->sizeInBytes() / 1024));
+    }
+}
+
+void LayoutThumbnails::dropAll()
+{
+    images.clear();
+    pending.clear();
+    emit thumbnailsInvalidated();
+}
@@ -0,0 +1,67 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+// Schematic previews of layouts for the dialog's list.
+//
+// A thumbnail is drawn from the parsed dock geometry of the layout's window
+// state (see WindowState), never from a screenshot. Rendering happens on a
+// worker thread and is only requested for rows the view actually paints.
+// Finished images are kept in a memory cache bounded by size, and as PNG
+// files named after the hash of the state, so an unchanged layout is never
+// drawn twice, even across restarts or renames.
+class LayoutThumbnails : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int thumbnailWidth = 96;
+    static constexpr int thumbnailHeight = 54;
+
+    static LayoutThumbnails &instance();
+
+    // Where the PNG files are kept; set once from obs_module_load. Files no
+    // stored layout state maps to any more are removed in the background.
+    void setCacheDirectory(const QString &path);
+
+    // Waits for the worker; must be called before the store shuts down
+    void shutdown();
+
+    static QSize thumbnailSize() { return QSize(thumbnailWidth, thumbnailHeight); }
+
+    // UI thread only. Returns a transparent image and starts rendering if the
+    // thumbnail is not cached yet; thumbnailReady() follows.
+    QImage thumbnail(const QString &layoutName);
+
+signals:
+    void thumbnailReady(const QString &layoutName);
+
+    // Every thumbnail has to be asked for again, e.g. for different screens
+    void thumbnailsInvalidated();
+
+private:
+    LayoutThumbnails();
+
+    void requestRender(const QString &layoutName);
+    void onRendered(const QString &layoutName, quint64 ticket, const QImage &image);
+    void drop(const QString &layoutName);
+    void onLayoutRenamed(const QString &oldName, const QString &newName);
+    void dropAll();
+
+    QThreadPool pool;
+    QString cacheDirectory;
+    QCache<QString, QImage> images; // Cost in KiB
+    QHash<QString, quint64> pending; // Render in flight, by ticket
+    quint64 nextTicket = 0;
+    QImage blank;
+};
@@ -0,0 +1,213 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "partial-layout.hpp"
+#include "layout-store.hpp"
+#include "restore-scheduler.hpp"
+
+#include <obs-module.h>
+#include <obs-frontend-api.h>
+
+#include <QDockWidget>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+static const QString docksKey = QStringLiteral("Docks");
+
+static const char *area_id(Qt::DockWidgetArea area)
+{
+    switch (area) {
+    case Qt::RightDockWidgetArea:
+        return "right";
+    case Qt::TopDockWidgetArea:
+        return "top";
+    case Qt::BottomDockWidgetArea:
+        return "bottom";
+    default:
+        return "left";
+    }
+}
+
+static Qt::DockWidgetArea area_from_id(const QString &id)
+{
+    if (id == QLatin1String("right"))
+        return Qt::RightDockWidgetArea;
+    if (id == QLatin1String("top"))
+        return Qt::TopDockWidgetArea;
+    if (id == QLatin1String("bottom"))
+        return Qt::BottomDockWidgetArea;
+    return Qt::LeftDockWidgetArea;
+}
+
+static Qt::Orientation area_orientation(Qt::DockWidgetArea area)
+{
+    return area == Qt::LeftDockWidgetArea || area == Qt::RightDockWidgetArea ? Qt::Horizontal : Qt::Vertical;
+}
+
+// Floating tab groups reparent docks, so search recursively, once per call
+static QHash<QString, QDockWidget *> docks_by_name(QMainWindow *mainWindow)
+{
+    QHash<QString, QDockWidget *> docks;
+    for (QDockWidget *dock : mainWindow->findChildren<QDockWidget *>())
+        docks.insert(dock->objectName(), dock);
+    return docks;
+}
+
+bool PartialLayout::isPartial(const QString &layoutName)
+{
+    return !LayoutStore::instance().value(layoutName, docksKey).isEmpty();
+}
+
+QVector<PartialLayout::DockPlacement> PartialLayout::capture(QMainWindow *mainWindow, const QStringList &dockNames)
+{
+    QVector<DockPlacement> result;
+    const QHash<QString, QDockWidget *> docksByName = docks_by_name(mainWindow);
+    for (const QString &name : dockNames) {
+        QDockWidget *dock = docksByName.value(name);
+        if (!dock)
+            continue;
+
+        DockPlacement placement;
+        placement.objectName = name;
+        placement.area = mainWindow->dockWidgetArea(dock);
+        placement.floating = dock->isFloating();
+        placement.visible = !dock->isHidden();
+        placement.geometry = dock->geometry();
+        placement.size = area_orientation(placement.area) == Qt::Horizontal ? dock->width() : dock->height();
+        result.append(placement);
+    }
+    return result;
+}
+
+QVector<PartialLayout::DockPlacement> PartialLayout::placements(const QString &layoutName)
+{
+    QVector<DockPlacement> result;
+    const QJsonObject root = QJsonDocument::fromJson(LayoutStore::instance().value(layoutName, docksKey)).object();
+    for (const QJsonValue &value : root.value("docks").toArray()) {
+        const QJsonObject dock = value.toObject();
+        const QJsonArray geometry = dock.value("geometry").toArray();
+
+        DockPlacement placement;
+        placement.objectName = dock.value("name").toString();
+        placement.area = area_from_id(dock.value("area").toString());
+        placement.floating = dock.value("floating").toBool();
+        placement.visible = dock.value("visible").toBool();
+        placement.size = dock.value("size").toInt();
+        if (geometry.size() == 4)
+            placement.geometry = QRect(geometry[0].toInt(), geometry[1].toInt(), geometry[2].toInt(),
+                                       geometry[3].toInt());
+        if (!placement.objectName.isEmpty())
+            result.append(placement);
+    }
+    return result;
+}
+
+void PartialLayout::setPlacements(const QString &layoutName, const QVector<DockPlacement> &placements)
+{
+    QJsonArray docks;
+    for (const DockPlacement &placement : placements) {
+        QJsonObject dock;
+        dock["name"] = placement.objectName;
+        dock["area"] = area_id(placement.area);
+        dock["floating"] = placement.floating;
+        dock["visible"] = placement.visible;
+        dock["size"] = placement.size;
+        dock["geometry"] = QJsonArray{placement.geometry.x(), placement.geometry.y(), placement.geometry.width(),
+                                      placement.geometry.height()};
+        docks.append(dock);
+    }
+
+    QJsonObject root;
+    root["docks"] = docks;
+    LayoutStore::instance().setValue(layoutName, docksKey, QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
+
+LayoutSwitcher::Plan PartialLayout::plan(QMainWindow *mainWindow, const QStringList &layoutNames, bool everything)
+{
+    using LayoutSwitcher::Change;
+
+    // Later layouts override earlier ones dock by dock
+    QVector<DockPlacement> merged;
+    QHash<QString, int> indexByName;
+    for (const QString &layoutName : layoutNames) {
+        for (const DockPlacement &placement : placements(layoutName)) {
+            auto found = indexByName.constFind(placement.objectName);
+            if (found != indexByName.constEnd()) {
+                merged[*found] = placement;
+            } else {
+                indexByName.insert(placement.objectName, int(merged.size()));
+                merged.append(placement);
+            }
+        }
+    }
+
+    LayoutSwitcher::Plan result;
+    result.fullRestore = false;
+
+    QVector<Change> hides, docks, shows, moves, resizes;
+    const QHash<QString, QDockWidget *> docksByName = docks_by_name(mainWindow);
+    for (const DockPlacement &placement : merged) {
+        // Docks of plugins that are not loaded are left out
+        QDockWidget *dock = docksByName.value(placement.objectName);
+        if (!dock)
+            continue;
+
+        const int before = int(hides.size() + docks.size() + shows.size() + moves.size() + resizes.size());
+        if (!placement.visible) {
+            if (everything || !dock->isHidden())
+                hides.append(Change{Change::Hide, dock});
+        } else {
+            if (placement.floating) {
+                if (everything || !dock->isFloating()) {
+                    Change change{Change::Float, dock};
+                    change.geometry = placement.geometry;
+                    docks.append(change);
+                } else if (dock->geometry() != placement.geometry) {
+                    Change change{Change::MoveFloating, dock};
+                    change.geometry = placement.geometry;
+                    moves.append(change);
+                }
+            } else {
+                if (everything || dock->isFloating() || mainWindow->dockWidgetArea(dock) != placement.area) {
+                    Change change{Change::Dock, dock};
+                    change.area = placement.area;
+                    docks.append(change);
+                }
+
+                const Qt::Orientation orientation = area_orientation(placement.area);
+                const int extent = orientation == Qt::Horizontal ? dock->width() : dock->height();
+                if (placement.size > 0 && (everything || extent != placement.size)) {
+                    Change change{Change::Resize, dock};
+                    change.size = placement.size;
+                    change.orientation = orientation;
+                    resizes.append(change);
+                }
+            }
+
+            if (everything || dock->isHidden())
+                shows.append(Change{Change::Show, dock});
+        }
+
+        if (hides.size() + docks.size() + shows.size() + moves.size() + resizes.size() > before)
+            ++result.changedDocks;
+    }
+
+    // Docks are moved before they are shown, so they never flash at their
+    // old place, and resized once everything is where it belongs
+    result.changes = hides + docks + shows + moves + resizes;
+    return result;
+}
+
+bool PartialLayout::apply(const QStringList &layoutNames)
+{
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    QMainWindow *mainWindow = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+    if (!scheduler || !mainWindow || layoutNames.isEmpty())
+        return false;
+
+    scheduler->applyPlan(layoutNames.join(QStringLiteral(" + ")), plan(mainWindow, layoutNames));
+    return true;
+}
@@ -0,0 +1,49 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include "layout-switcher.hpp"
+
+#include <QMainWindow>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Layouts that only place a chosen set of docks.
+//
+// Instead of a whole-window saveState() a partial layout keeps one placement
+// per dock in its "Docks" value (JSON): area, floating geometry, visibility
+// and extent. Applying one or several of them only looks up and changes the
+// docks they name, so the cost follows the number of docks touched, and
+// every other dock stays where the operator put it. Later layouts win when
+// several place the same dock.
+namespace PartialLayout {
+
+struct DockPlacement {
+    QString objectName;
+    Qt::DockWidgetArea area = Qt::LeftDockWidgetArea;
+    bool floating = false;
+    bool visible = false;
+    QRect geometry; // Floating window geometry
+    int size = 0;   // Width in the left and right areas, height otherwise
+};
+
+bool isPartial(const QString &layoutName);
+
+QVector<DockPlacement> capture(QMainWindow *mainWindow, const QStringList &dockNames);
+
+QVector<DockPlacement> placements(const QString &layoutName);
+void setPlacements(const QString &layoutName, const QVector<DockPlacement> &placements);
+
+// Changes that bring the named docks of all layouts in place, never a full
+// restore. With everything set, docks already in place are changed too, for
+// plans that run after other changes.
+LayoutSwitcher::Plan plan(QMainWindow *mainWindow, const QStringList &layoutNames, bool everything = false);
+
+// Plans and runs the layouts as one switch through the restore scheduler
+bool apply(const QStringList &layoutNames);
+
+} // namespace PartialLayout
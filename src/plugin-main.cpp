@@ -10,19 +10,51 @@ OBS Dock Layout Manager
 #include <QLabel>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QListView>
 #include <QListWidget>
+#include <QLineEdit>
+#include <QTabWidget>
+#include <QDialogButtonBox>
 #include <QPushButton>
 #include <QMessageBox>
 #include <QMouseEvent>
 #include <QByteArray>
 #include <QApplication>
 #include <QDockWidget>
-#include <QSettings>
 #include <QInputDialog>
 #include <QTimer>
 #include <QFileInfo>
 #include <QDir>
 #include <QFont>
+#include <QFileDialog>
+#include <QMenu>
+#include <QSpinBox>
+#include <QElapsedTimer>
+
+#include "diagnostics.hpp"
+#include "diagnostics-view.hpp"
+#include "dock-index.hpp"
+#include "dock-readiness.hpp"
+#include "dock-suspender.hpp"
+#include "layout-api.hpp"
+#include "layout-bundle.hpp"
+#include "layout-filter-model.hpp"
+#include "layout-history.hpp"
+#include "layout-hotkeys.hpp"
+#include "layout-list-model.hpp"
+#include "layout-rules.hpp"
+#include "layout-search.hpp"
+#include "layout-store.hpp"
+#include "layout-switcher.hpp"
+#include "layout-thumbnails.hpp"
+#include "partial-layout.hpp"
+#include "prepared-layout.hpp"
+#include "restore-scheduler.hpp"
+#include "rules-view.hpp"
+#include "screen-config.hpp"
+
+#include <algorithm>
+#include <future>
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-dock-layout-manager", "en-US")
@@ -30,7 +62,18 @@ OBS_MODULE_USE_DEFAULT_LOCALE("obs-dock-layout-manager", "en-US")
 #define PLUGIN_NAME "OBS Dock Layout Manager"
 #define PLUGIN_VERSION "1.1.5" // Update in 'buildspec.json' too
 
-static QString settingsFilePath; // Global variable for settings file path
+static QString settingsFilePath; // Legacy INI file, migrated on first load
+static QString databaseFilePath; // Binary layout database
+
+// Upper bound for waiting on docks at startup, stored as RestoreDeadlineMs
+static constexpr int defaultRestoreDeadlineMs = 10000;
+
+static int restore_deadline_ms()
+{
+    bool ok;
+    int deadlineMs = LayoutStore::instance().setting("RestoreDeadlineMs").toInt(&ok);
+    return ok && deadlineMs >= 0 ? deadlineMs : defaultRestoreDeadlineMs;
+}
 
 class DockListDialog : public QDialog
 {
@@ -41,17 +84,38 @@ public:
         : QDialog(parent)
     {
         setWindowTitle("Dock Layout Manager");
-        resize(400, 300);
-
-        QVBoxLayout *layout = new QVBoxLayout(this);
-
-        // Initialize the list widget
-        list_widget = new QListWidget(this);
-        list_widget->setSelectionMode(QAbstractItemView::SingleSelection);
-        layout->addWidget(list_widget);
-
-        // Install event filter on the list widget's viewport
-        list_widget->viewport()->installEventFilter(this);
+        resize(480, 360);
+
+        // Layout management and timings live on separate tabs
+        QTabWidget *tabs = new QTabWidget(this);
+        QWidget *layoutsPage = new QWidget(tabs);
+        QVBoxLayout *layout = new QVBoxLayout(layoutsPage);
+
+        // Narrows the list down to layouts whose names or tags match the
+        // typed words, best matches and recently used layouts first
+        filterEdit = new QLineEdit(this);
+        filterEdit->setPlaceholderText("Search layouts by name or tag");
+        filterEdit->setClearButtonEnabled(true);
+        layout->addWidget(filterEdit);
+
+        // The model follows the store row by row, the proxy filters and ranks it
+        layoutModel = new LayoutListModel(this);
+        filterModel = new LayoutFilterModel(this);
+        filterModel->setSourceModel(layoutModel);
+        connect(filterEdit, &QLineEdit::textChanged, filterModel, &LayoutFilterModel::setQuery);
+
+        // Initialize the list view; rows all have the same height, so only
+        // the visible ones are ever measured
+        list_view = new QListView(this);
+        list_view->setModel(filterModel);
+        list_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+        list_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        list_view->setUniformItemSizes(true);
+        list_view->setIconSize(LayoutThumbnails::thumbnailSize());
+        layout->addWidget(list_view);
+
+        // Install event filter on the list view's viewport
+        list_view->viewport()->installEventFilter(this);
 
         // Add a horizontal layout for the buttons
         QHBoxLayout *buttonLayout = new QHBoxLayout;
@@ -62,6 +126,11 @@ public:
         connect(newButton, &QPushButton::clicked, this, &DockListDialog::newDockLayout);
         buttonLayout->addWidget(newButton);
 
+        QPushButton *newPartialButton = new QPushButton("New Partial", this);
+        newPartialButton->setToolTip("Create a layout that only places the docks you choose; select several partial layouts to restore them together");
+        connect(newPartialButton, &QPushButton::clicked, this, &DockListDialog::newPartialLayout);
+        buttonLayout->addWidget(newPartialButton);
+
         saveButton = new QPushButton("Save", this);
         saveButton->setToolTip("Save the current dock layout");
         connect(saveButton, &QPushButton::clicked, this, &DockListDialog::saveDockLayout);
@@ -87,17 +156,93 @@ public:
         connect(setDefaultButton, &QPushButton::clicked, this, &DockListDialog::setAsDefaultLayout);
         buttonLayout->addWidget(setDefaultButton);
 
+        suspendButton = new QPushButton("Suspend", this);
+        suspendButton->setToolTip("Choose docks whose content is unloaded while the selected layout hides them");
+        connect(suspendButton, &QPushButton::clicked, this, &DockListDialog::editSuspendedDocks);
+        buttonLayout->addWidget(suspendButton);
+
+        tagsButton = new QPushButton("Tags", this);
+        tagsButton->setToolTip("Tag the selected dock layout, e.g. with the show or operator, to find it by searching");
+        connect(tagsButton, &QPushButton::clicked, this, &DockListDialog::editLayoutTags);
+        buttonLayout->addWidget(tagsButton);
+
+        QPushButton *exportButton = new QPushButton("Export", this);
+        exportButton->setToolTip("Export dock layouts as a bundle for another machine, or as a human-readable INI file");
+        QMenu *exportMenu = new QMenu(exportButton);
+        exportMenu->addAction("Bundle...", this, &DockListDialog::exportLayoutBundle);
+        exportMenu->addAction("INI File...", this, &DockListDialog::exportDockLayouts);
+        exportButton->setMenu(exportMenu);
+        buttonLayout->addWidget(exportButton);
+
+        importButton = new QPushButton("Import", this);
+        importButton->setToolTip("Add the layouts of a bundle exported on another machine");
+        connect(importButton, &QPushButton::clicked, this, &DockListDialog::importLayoutBundle);
+        buttonLayout->addWidget(importButton);
+
         // Add the button layout to the main layout
         layout->addLayout(buttonLayout);
 
-        // Set the main layout
-        setLayout(layout);
+        // Startup restore waits for the default layout's docks up to this limit
+        QHBoxLayout *deadlineLayout = new QHBoxLayout;
+        deadlineLayout->addWidget(new QLabel("Wait for docks at startup for at most:", this));
+        QSpinBox *deadlineSpinBox = new QSpinBox(this);
+        deadlineSpinBox->setRange(0, 120);
+        deadlineSpinBox->setSuffix(" s");
+        deadlineSpinBox->setValue(restore_deadline_ms() / 1000);
+        deadlineSpinBox->setToolTip("The default layout is applied as soon as all of its docks exist, or after this long");
+        connect(deadlineSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int seconds) {
+            LayoutStore::instance().setSetting("RestoreDeadlineMs", QString::number(seconds * 1000));
+        });
+        deadlineLayout->addWidget(deadlineSpinBox);
+        deadlineLayout->addStretch();
+        layout->addLayout(deadlineLayout);
+
+        // Layout switches yield to the event loop after this much work
+        QHBoxLayout *budgetLayout = new QHBoxLayout;
+        budgetLayout->addWidget(new QLabel("Layout switch time per frame:", this));
+        QSpinBox *budgetSpinBox = new QSpinBox(this);
+        budgetSpinBox->setRange(1, 100);
+        budgetSpinBox->setSuffix(" ms");
+        budgetSpinBox->setValue(qMax(1, RestoreScheduler::sliceBudgetSettingUs() / 1000));
+        budgetSpinBox->setToolTip("Lower values keep the preview smoother while switching, higher values finish sooner");
+        connect(budgetSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int milliseconds) {
+            LayoutStore::instance().setSetting("RestoreSliceBudgetUs", QString::number(milliseconds * 1000));
+        });
+        budgetLayout->addWidget(budgetSpinBox);
+        budgetLayout->addStretch();
+        layout->addLayout(budgetLayout);
+
+        // Older undo steps are dropped beyond this much memory
+        QHBoxLayout *historyLayout = new QHBoxLayout;
+        historyLayout->addWidget(new QLabel("Undo history memory:", this));
+        QSpinBox *historySpinBox = new QSpinBox(this);
+        historySpinBox->setRange(64, 65536);
+        historySpinBox->setSingleStep(64);
+        historySpinBox->setSuffix(" KB");
+        historySpinBox->setValue(LayoutHistory::memoryLimitSettingKb());
+        historySpinBox->setToolTip("Dock changes are captured automatically and can be undone with the Undo and Redo dock layout hotkeys");
+        connect(historySpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+                [](int limitKb) { LayoutHistory::instance().setMemoryLimitKb(limitKb); });
+        historyLayout->addWidget(historySpinBox);
+        historyLayout->addStretch();
+        layout->addLayout(historyLayout);
+
+        if (RestoreScheduler *scheduler = RestoreScheduler::instance()) {
+            connect(scheduler, &RestoreScheduler::finished, this, &DockListDialog::onRestoreFinished);
+        }
+
+        tabs->addTab(layoutsPage, "Layouts");
+        tabs->addTab(new RulesView(tabs), "Rules");
+        tabs->addTab(new DiagnosticsView(tabs), "Diagnostics");
 
-        // Connect the selection change signal to update the button states
-        connect(list_widget, &QListWidget::itemSelectionChanged, this, &DockListDialog::updateButtonStates);
+        // Set the main layout
+        QVBoxLayout *dialogLayout = new QVBoxLayout(this);
+        dialogLayout->addWidget(tabs);
 
-        // Populate the list initially
-        updateDockList();
+        // Connect the selection change signal to update the button states;
+        // rows filtered out or removed also leave the selection
+        connect(list_view->selectionModel(), &QItemSelectionModel::selectionChanged, this,
+                &DockListDialog::updateButtonStates);
 
         // Initialize the buttons' states
         updateButtonStates();
@@ -106,11 +251,11 @@ public:
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override
     {
-        if (obj == list_widget->viewport() && event->type() == QEvent::MouseButtonPress) {
+        if (obj == list_view->viewport() && event->type() == QEvent::MouseButtonPress) {
             QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
-            QModelIndex clickedIndex = list_widget->indexAt(mouseEvent->pos());
+            QModelIndex clickedIndex = list_view->indexAt(mouseEvent->pos());
             if (!clickedIndex.isValid()) {
-                list_widget->clearSelection();
+                list_view->clearSelection();
                 updateButtonStates();
                 return true; // Event has been handled
             }
@@ -119,46 +264,19 @@ protected:
     }
 
 private slots:
-    void updateDockList()
-    {
-        list_widget->clear();
-
-        QSettings settings(settingsFilePath, QSettings::IniFormat);
-
-        QStringList layoutNames = settings.childGroups();
-
-        // Get default layout from "Settings" group
-        settings.beginGroup("Settings");
-        QString defaultLayoutName = settings.value("DefaultLayout").toString();
-        settings.endGroup();
-
-        for (const QString &name : layoutNames) {
-            if (name == "Settings") continue; // Skip the Settings group
-            QListWidgetItem *item = new QListWidgetItem(name, list_widget);
-
-            if (name == defaultLayoutName) {
-                // Set the font to bold to indicate default
-                QFont boldFont = item->font();
-                boldFont.setBold(true);
-                item->setFont(boldFont);
-
-                // Optionally, set a tooltip to indicate default
-                item->setToolTip("Default layout");
-            }
-
-            list_widget->addItem(item);
-        }
-    }
-
     void updateButtonStates()
     {
-        bool validSelection = !list_widget->selectedItems().isEmpty();
+        // Only restoring works on several layouts at once
+        QString layoutName = selectedLayoutName();
+        bool validSelection = !layoutName.isEmpty();
 
         saveButton->setEnabled(validSelection);
-        restoreButton->setEnabled(validSelection);
+        restoreButton->setEnabled(!selectedLayoutNames().isEmpty());
         deleteButton->setEnabled(validSelection);
-        setDefaultButton->setEnabled(validSelection);
+        setDefaultButton->setEnabled(validSelection && !PartialLayout::isPartial(layoutName));
         renameButton->setEnabled(validSelection); // Enable/disable Rename button
+        suspendButton->setEnabled(validSelection);
+        tagsButton->setEnabled(validSelection);
     }
 
     void saveDockLayout()
@@ -171,10 +289,8 @@ private slots:
             return;
         }
 
-        QList<QListWidgetItem *> selectedItems = list_widget->selectedItems();
-        if (!selectedItems.isEmpty()) {
-            QString layoutName = selectedItems.first()->text().trimmed();
-
+        QString layoutName = selectedLayoutName();
+        if (!layoutName.isEmpty()) {
             // Confirm overwrite
             QMessageBox::StandardButton reply;
             reply = QMessageBox::question(this, "Overwrite Layout",
@@ -185,12 +301,21 @@ private slots:
                 return;
             }
 
-            QSettings settings(settingsFilePath, QSettings::IniFormat);
-
-            // Remove existing layout
-            settings.remove(layoutName);
+            if (PartialLayout::isPartial(layoutName)) {
+                // Recapture the same docks, the others stay out of the layout
+                QStringList dockNames;
+                for (const PartialLayout::DockPlacement &placement : PartialLayout::placements(layoutName)) {
+                    dockNames.append(placement.objectName);
+                }
+                QVector<PartialLayout::DockPlacement> placements = PartialLayout::capture(main_window, dockNames);
+                if (placements.isEmpty()) {
+                    QMessageBox::warning(this, "Error", "None of the docks of this layout exist right now.");
+                    return;
+                }
+                PartialLayout::setPlacements(layoutName, placements);
+                return;
+            }
 
-            // Now proceed to save the new layout
             QByteArray windowState = main_window->saveState();
 
             if (windowState.isEmpty()) {
@@ -198,13 +323,8 @@ private slots:
                 return;
             }
 
-            settings.beginGroup(layoutName);
-            settings.setValue("WindowState", windowState);
-            settings.endGroup(); // layoutName
-
-            settings.sync(); // Ensure changes are written to disk
-
-            updateDockList(); // Update the list to reflect changes
+            // Written to disk in the background
+            LayoutStore::instance().setWindowState(layoutName, windowState, ScreenConfig::instance().currentKey());
         } else {
             // No layout selected, prompt the user to select a layout
             QMessageBox::information(this, "No Layout Selected", "Please select an existing layout to overwrite.");
@@ -214,29 +334,38 @@ private slots:
 
     void restoreDockLayout()
     {
-        void *main_window_handle = obs_frontend_get_main_window();
-        QMainWindow *main_window = static_cast<QMainWindow *>(main_window_handle);
+        RestoreScheduler *scheduler = RestoreScheduler::instance();
 
-        if (!main_window) {
+        if (!scheduler) {
             QMessageBox::warning(this, "Error", "Failed to get main window");
             return;
         }
 
-        QList<QListWidgetItem *> selectedItems = list_widget->selectedItems();
+        QStringList layoutNames = selectedLayoutNames();
 
-        if (!selectedItems.isEmpty()) {
-            QString layoutName = selectedItems.first()->text();
+        if (layoutNames.size() > 1 || (layoutNames.size() == 1 && PartialLayout::isPartial(layoutNames.first()))) {
+            // Partial layouts compose; whole-window layouts would replace each other
+            for (const QString &name : layoutNames) {
+                if (!PartialLayout::isPartial(name)) {
+                    QMessageBox::warning(this, "Error", QString("Only partial layouts can be restored together, '%1' places every dock.").arg(name));
+                    return;
+                }
+            }
+            pendingRestoreName = layoutNames.join(" + ");
+            PartialLayout::apply(layoutNames);
+            return;
+        }
 
-            QSettings settings(settingsFilePath, QSettings::IniFormat);
-            settings.beginGroup(layoutName);
-            QByteArray windowState = settings.value("WindowState").toByteArray();
-            settings.endGroup();
+        QString layoutName = layoutNames.value(0);
+
+        if (!layoutName.isEmpty()) {
+            QByteArray windowState = LayoutStore::instance().windowState(layoutName, ScreenConfig::instance().currentKey());
 
             if (!windowState.isEmpty()) {
-                if (!main_window->restoreState(windowState)) {
-                    QMessageBox::warning(this, "Error", "Failed to restore dock layout");
-                    return;
-                }
+                // Only touches changed docks, spread over several frames;
+                // failures are reported from onRestoreFinished
+                pendingRestoreName = layoutName;
+                scheduler->switchTo(layoutName, windowState);
             } else {
                 QMessageBox::warning(this, "Error", "Selected layout does not contain valid window state");
                 return;
@@ -249,11 +378,9 @@ private slots:
 
     void deleteDockLayout()
     {
-        QList<QListWidgetItem *> selectedItems = list_widget->selectedItems();
-
-        if (!selectedItems.isEmpty()) {
-            QString layoutName = selectedItems.first()->text();
+        QString layoutName = selectedLayoutName();
 
+        if (!layoutName.isEmpty()) {
             QMessageBox::StandardButton reply;
             reply = QMessageBox::question(this, "Delete Layout",
                                         QString("Are you sure you want to delete the '%1' layout?").arg(layoutName),
@@ -263,22 +390,8 @@ private slots:
                 return;
             }
 
-            QSettings settings(settingsFilePath, QSettings::IniFormat);
-
-            // Check if the deleted layout is the default
-            settings.beginGroup("Settings");
-            QString defaultLayoutName = settings.value("DefaultLayout").toString();
-            if (defaultLayoutName == layoutName) {
-                settings.remove("DefaultLayout");
-            }
-            settings.endGroup();
-
-            // Remove the entire group corresponding to the layout
-            settings.remove(layoutName);
-
-            settings.sync(); // Ensure changes are written to disk
-
-            updateDockList();
+            // Also clears the default if it pointed at this layout
+            LayoutStore::instance().removeLayout(layoutName);
         } else {
             QMessageBox::warning(this, "Error", "Please select a layout to delete");
             return;
@@ -287,11 +400,9 @@ private slots:
 
     void setAsDefaultLayout()
     {
-        QList<QListWidgetItem *> selectedItems = list_widget->selectedItems();
-
-        if (!selectedItems.isEmpty()) {
-            QString layoutName = selectedItems.first()->text();
+        QString layoutName = selectedLayoutName();
 
+        if (!layoutName.isEmpty()) {
             // Save the current window state to the selected layout
             void *main_window_handle = obs_frontend_get_main_window();
             QMainWindow *main_window = static_cast<QMainWindow *>(main_window_handle);
@@ -308,21 +419,11 @@ private slots:
                 return;
             }
 
-            QSettings settings(settingsFilePath, QSettings::IniFormat);
-
-            settings.beginGroup(layoutName);
-            settings.setValue("WindowState", windowState);
-            settings.endGroup(); // layoutName
-
-            settings.sync(); // Ensure changes are written to disk
+            LayoutStore &store = LayoutStore::instance();
+            store.setWindowState(layoutName, windowState, ScreenConfig::instance().currentKey());
 
             // Now set this layout as the default
-            settings.beginGroup("Settings");
-            settings.setValue("DefaultLayout", layoutName);
-            settings.endGroup();
-            settings.sync(); // Ensure changes are written to disk
-
-            updateDockList();
+            store.setDefaultLayout(layoutName);
         } else {
             QMessageBox::warning(this, "Error", "Please select a layout to set as default");
             return;
@@ -340,12 +441,10 @@ private slots:
 
         newLayoutName = newLayoutName.trimmed(); // Remove any extra whitespace
 
-        QSettings settings(settingsFilePath, QSettings::IniFormat);
+        LayoutStore &store = LayoutStore::instance();
 
         // Check if a layout with this name already exists
-        QStringList existingLayouts = settings.childGroups();
-        existingLayouts.removeAll("Settings"); // Exclude the Settings group
-        if (existingLayouts.contains(newLayoutName)) {
+        if (store.contains(newLayoutName)) {
             QMessageBox::warning(this, "Error", QString("A layout with the name '%1' already exists. Please choose a different name.").arg(newLayoutName));
             return;
         }
@@ -364,28 +463,82 @@ private slots:
             QMessageBox::warning(this, "Error", "Failed to retrieve the main window. The new layout will be created without a valid window state.");
         }
 
-        // Create a new layout group and initialize it with the captured WindowState
-        settings.beginGroup(newLayoutName);
-        settings.setValue("WindowState", windowState);
-        settings.endGroup();
+        // Create a new layout and initialize it with the captured WindowState
+        store.setWindowState(newLayoutName, windowState, ScreenConfig::instance().currentKey());
+    }
+
+    void newPartialLayout()
+    {
+        QMainWindow *main_window = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+
+        if (!main_window) {
+            QMessageBox::warning(this, "Error", "Failed to get main window");
+            return;
+        }
+
+        bool ok;
+        QString newLayoutName = QInputDialog::getText(this, "New Partial Layout", "Enter a name for the new layout:", QLineEdit::Normal, "", &ok);
+
+        if (!ok || newLayoutName.trimmed().isEmpty()) {
+            return; // User cancelled or entered an empty name
+        }
 
-        settings.sync(); // Ensure changes are written to disk
+        newLayoutName = newLayoutName.trimmed();
+
+        if (LayoutStore::instance().contains(newLayoutName)) {
+            QMessageBox::warning(this, "Error", QString("A layout with the name '%1' already exists. Please choose a different name.").arg(newLayoutName));
+            return;
+        }
+
+        QDialog picker(this);
+        picker.setWindowTitle("New Partial Layout");
+        QVBoxLayout *pickerLayout = new QVBoxLayout(&picker);
+        pickerLayout->addWidget(new QLabel(QString("Docks the '%1' layout places where they are now:").arg(newLayoutName), &picker));
+
+        QListWidget *dockList = new QListWidget(&picker);
+        // Floating tab groups reparent docks, so search recursively
+        for (QDockWidget *dock : main_window->findChildren<QDockWidget *>()) {
+            if (dock->objectName().isEmpty()) {
+                continue; // Cannot be found again after a restart
+            }
+            QListWidgetItem *item = new QListWidgetItem(QString("%1 (%2)").arg(dock->windowTitle(), dock->objectName()), dockList);
+            item->setData(Qt::UserRole, dock->objectName());
+            item->setCheckState(Qt::Unchecked);
+        }
+        pickerLayout->addWidget(dockList);
+
+        QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &picker);
+        connect(buttons, &QDialogButtonBox::accepted, &picker, &QDialog::accept);
+        connect(buttons, &QDialogButtonBox::rejected, &picker, &QDialog::reject);
+        pickerLayout->addWidget(buttons);
+
+        if (picker.exec() != QDialog::Accepted) {
+            return;
+        }
+
+        QStringList dockNames;
+        for (int row = 0; row < dockList->count(); ++row) {
+            if (dockList->item(row)->checkState() == Qt::Checked) {
+                dockNames.append(dockList->item(row)->data(Qt::UserRole).toString());
+            }
+        }
+        if (dockNames.isEmpty()) {
+            return;
+        }
 
-        updateDockList();
+        PartialLayout::setPlacements(newLayoutName, PartialLayout::capture(main_window, dockNames));
     }
 
     // *** New slot for renaming a layout ***
     void renameDockLayout()
     {
-        QList<QListWidgetItem *> selectedItems = list_widget->selectedItems();
+        QString oldName = selectedLayoutName();
 
-        if (selectedItems.isEmpty()) {
+        if (oldName.isEmpty()) {
             QMessageBox::warning(this, "Error", "Please select a layout to rename.");
             return;
         }
 
-        QString oldName = selectedItems.first()->text();
-
         bool ok;
         QString newName = QInputDialog::getText(this, "Rename Layout",
                                                 QString("Enter a new name for the '%1' layout:").arg(oldName),
@@ -402,55 +555,251 @@ private slots:
             return;
         }
 
-        QSettings settings(settingsFilePath, QSettings::IniFormat);
+        LayoutStore &store = LayoutStore::instance();
 
         // Check if the new name already exists
-        QStringList existingLayouts = settings.childGroups();
-        existingLayouts.removeAll("Settings"); // Exclude the Settings group
-        if (existingLayouts.contains(newName)) {
+        if (store.contains(newName)) {
             QMessageBox::warning(this, "Error", QString("A layout with the name '%1' already exists. Please choose a different name.").arg(newName));
             return;
         }
 
-        // Retrieve the window state from the old layout
-        settings.beginGroup(oldName);
-        QByteArray windowState = settings.value("WindowState").toByteArray();
-        settings.endGroup();
-
-        if (windowState.isEmpty()) {
+        if (store.windowState(oldName).isEmpty() && !PartialLayout::isPartial(oldName)) {
             QMessageBox::warning(this, "Error", QString("The '%1' layout does not contain a valid window state.").arg(oldName));
             return;
         }
 
-        // Create the new layout group with the same window state
-        settings.beginGroup(newName);
-        settings.setValue("WindowState", windowState);
-        settings.endGroup();
+        // Moves the layout and updates the default if it was the old name
+        store.renameLayout(oldName, newName);
+    }
+    // *** End of renameDockLayout slot ***
 
-        // Remove the old layout group
-        settings.remove(oldName);
+    void editSuspendedDocks()
+    {
+        QString layoutName = selectedLayoutName();
 
-        // If the old layout was the default, update the default to the new name
-        settings.beginGroup("Settings");
-        QString defaultLayoutName = settings.value("DefaultLayout").toString();
-        if (defaultLayoutName == oldName) {
-            settings.setValue("DefaultLayout", newName);
+        if (layoutName.isEmpty()) {
+            QMessageBox::warning(this, "Error", "Please select a layout.");
+            return;
         }
-        settings.endGroup();
 
-        settings.sync(); // Ensure changes are written to disk
+        QMainWindow *main_window = static_cast<QMainWindow *>(obs_frontend_get_main_window());
 
-        updateDockList();
+        if (!main_window) {
+            QMessageBox::warning(this, "Error", "Failed to get main window");
+            return;
+        }
+
+        QDialog picker(this);
+        picker.setWindowTitle("Suspend Hidden Docks");
+        QVBoxLayout *pickerLayout = new QVBoxLayout(&picker);
+        pickerLayout->addWidget(new QLabel(QString("Unload these docks while the '%1' layout hides them:").arg(layoutName), &picker));
+
+        QListWidget *dockList = new QListWidget(&picker);
+        QStringList marked = DockSuspender::suspendedDocks(layoutName);
+        for (QDockWidget *dock : main_window->findChildren<QDockWidget *>()) {
+            if (dock->objectName().isEmpty()) {
+                continue; // Cannot be found again after a restart
+            }
+            QListWidgetItem *item = new QListWidgetItem(QString("%1 (%2)").arg(dock->windowTitle(), dock->objectName()), dockList);
+            item->setData(Qt::UserRole, dock->objectName());
+            item->setCheckState(marked.removeAll(dock->objectName()) > 0 ? Qt::Checked : Qt::Unchecked);
+        }
+        for (const QString &name : marked) {
+            // Docks of plugins that are not loaded right now
+            QListWidgetItem *item = new QListWidgetItem(name, dockList);
+            item->setData(Qt::UserRole, name);
+            item->setCheckState(Qt::Checked);
+        }
+        pickerLayout->addWidget(dockList);
+
+        QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &picker);
+        connect(buttons, &QDialogButtonBox::accepted, &picker, &QDialog::accept);
+        connect(buttons, &QDialogButtonBox::rejected, &picker, &QDialog::reject);
+        pickerLayout->addWidget(buttons);
+
+        if (picker.exec() != QDialog::Accepted) {
+            return;
+        }
+
+        QStringList dockNames;
+        for (int row = 0; row < dockList->count(); ++row) {
+            if (dockList->item(row)->checkState() == Qt::Checked) {
+                dockNames.append(dockList->item(row)->data(Qt::UserRole).toString());
+            }
+        }
+        DockSuspender::setSuspendedDocks(layoutName, dockNames);
+    }
+
+    void editLayoutTags()
+    {
+        QString layoutName = selectedLayoutName();
+
+        if (layoutName.isEmpty()) {
+            QMessageBox::warning(this, "Error", "Please select a layout.");
+            return;
+        }
+
+        bool ok;
+        QString text = QInputDialog::getText(this, "Layout Tags",
+                                             QString("Tags for the '%1' layout, separated by commas:").arg(layoutName),
+                                             QLineEdit::Normal, LayoutSearch::instance().tags(layoutName).join(", "), &ok);
+        if (!ok) {
+            return;
+        }
+
+        LayoutSearch::instance().setTags(layoutName, text.split(','));
+    }
+
+    void onRestoreFinished(const QString &layoutName, bool ok)
+    {
+        if (layoutName != pendingRestoreName) {
+            return; // Not started from this dialog
+        }
+        pendingRestoreName.clear();
+
+        if (!ok) {
+            QMessageBox::warning(this, "Error", "Failed to restore dock layout");
+        }
+    }
+
+    void exportDockLayouts()
+    {
+        QString exportPath = QFileDialog::getSaveFileName(this, "Export Dock Layouts",
+                                                          QDir::home().filePath("obs-dock-layouts.ini"),
+                                                          "INI files (*.ini)");
+        if (exportPath.isEmpty()) {
+            return; // User cancelled
+        }
+
+        if (!LayoutStore::instance().exportIni(exportPath)) {
+            QMessageBox::warning(this, "Error", QString("Failed to export dock layouts to '%1'.").arg(exportPath));
+        }
+    }
+
+    void exportLayoutBundle()
+    {
+        LayoutStore &store = LayoutStore::instance();
+        if (store.layoutNames().isEmpty()) {
+            QMessageBox::information(this, "Export Bundle", "There are no dock layouts to export.");
+            return;
+        }
+
+        QDialog picker(this);
+        picker.setWindowTitle("Export Bundle");
+        QVBoxLayout *pickerLayout = new QVBoxLayout(&picker);
+        pickerLayout->addWidget(new QLabel("Layouts to export:", &picker));
+
+        QListWidget *layoutList = new QListWidget(&picker);
+        for (const QString &name : store.layoutNames()) {
+            QListWidgetItem *item = new QListWidgetItem(name, layoutList);
+            item->setCheckState(Qt::Checked);
+        }
+        pickerLayout->addWidget(layoutList);
+
+        QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &picker);
+        connect(buttons, &QDialogButtonBox::accepted, &picker, &QDialog::accept);
+        connect(buttons, &QDialogButtonBox::rejected, &picker, &QDialog::reject);
+        pickerLayout->addWidget(buttons);
+
+        if (picker.exec() != QDialog::Accepted) {
+            return;
+        }
+
+        QStringList names;
+        for (int row = 0; row < layoutList->count(); ++row) {
+            if (layoutList->item(row)->checkState() == Qt::Checked) {
+                names.append(layoutList->item(row)->text());
+            }
+        }
+        if (names.isEmpty()) {
+            return;
+        }
+
+        QString exportPath = QFileDialog::getSaveFileName(this, "Export Bundle",
+                                                          QDir::home().filePath("obs-dock-layouts.odlb"),
+                                                          "Dock layout bundles (*.odlb)");
+        if (exportPath.isEmpty()) {
+            return; // User cancelled
+        }
+
+        QString error;
+        if (!LayoutBundle::exportLayouts(exportPath, names, error)) {
+            QMessageBox::warning(this, "Error", QString("Failed to export dock layouts to '%1': %2").arg(exportPath, error));
+        }
+    }
+
+    void importLayoutBundle()
+    {
+        QString importPath = QFileDialog::getOpenFileName(this, "Import Bundle", QDir::homePath(),
+                                                          "Dock layout bundles (*.odlb)");
+        if (importPath.isEmpty()) {
+            return; // User cancelled
+        }
+
+        const QStringList policies = {"Keep the existing layout", "Replace the existing layout",
+                                      "Import under a new name"};
+        bool ok;
+        QString choice = QInputDialog::getItem(this, "Import Bundle", "When a layout with the same name exists:",
+                                               policies, 0, false, &ok);
+        if (!ok) {
+            return;
+        }
+
+        // The bundle is read in the background; the list fills in as it goes
+        LayoutBundle::ConflictPolicy policy = LayoutBundle::ConflictPolicy(policies.indexOf(choice));
+        importButton->setEnabled(false);
+        LayoutBundle::importLayouts(importPath, policy, this, [this](const LayoutBundle::ImportResult &result) {
+            importButton->setEnabled(true);
+
+            QString summary = QString("Imported %1 layouts (%2 replaced, %3 renamed), skipped %4.")
+                                  .arg(result.imported)
+                                  .arg(result.overwritten)
+                                  .arg(result.renamed)
+                                  .arg(result.skipped);
+            if (result.corrupt > 0) {
+                summary += QString("\n%1 damaged layouts were left out.").arg(result.corrupt);
+            }
+            if (!result.error.isEmpty()) {
+                QMessageBox::warning(this, "Import Bundle", result.error + "\n" + summary);
+            } else {
+                QMessageBox::information(this, "Import Bundle", summary);
+            }
+        });
     }
-    // *** End of renameDockLayout slot ***
 
 private:
-    QListWidget *list_widget;
+    // Empty unless exactly one layout is selected
+    QString selectedLayoutName() const
+    {
+        QStringList names = selectedLayoutNames();
+        return names.size() == 1 ? names.first() : QString();
+    }
+
+    // In list order, which is the order partial layouts are applied in
+    QStringList selectedLayoutNames() const
+    {
+        QModelIndexList selected = list_view->selectionModel()->selectedRows();
+        std::sort(selected.begin(), selected.end());
+        QStringList names;
+        for (const QModelIndex &index : selected) {
+            names.append(layoutModel->layoutName(filterModel->mapToSource(index)));
+        }
+        return names;
+    }
+
+    QLineEdit *filterEdit;
+    QListView *list_view;
+    LayoutListModel *layoutModel;
+    LayoutFilterModel *filterModel;
     QPushButton *saveButton;
     QPushButton *restoreButton;
     QPushButton *deleteButton;
     QPushButton *setDefaultButton;
     QPushButton *renameButton; // New Rename button
+    QPushButton *suspendButton;
+    QPushButton *tagsButton;
+    QPushButton *importButton;
+    QString pendingRestoreName; // Layout this dialog is switching to
 };
 
 #include "plugin-main.moc"
@@ -458,7 +807,58 @@ private:
 // Global pointer to the dialog
 static DockListDialog *dockListDialog = nullptr;
 
-// Function to restore the default layout after a delay
+// Default layout decoded on a worker thread while OBS is still loading
+static std::future<PreparedLayout> preparedDefaultLayout;
+
+static PreparedLayout prepare_default_layout(const QString &screenKey)
+{
+    QString defaultLayoutName = LayoutStore::instance().defaultLayout();
+    if (defaultLayoutName.isEmpty()) {
+        return PreparedLayout();
+    }
+    return PreparedLayout::prepare(defaultLayoutName, screenKey);
+}
+
+static void apply_default_layout(const PreparedLayout &layout)
+{
+    void *main_window_handle = obs_frontend_get_main_window();
+    QMainWindow *main_window = static_cast<QMainWindow *>(main_window_handle);
+
+    if (!main_window) {
+        blog(LOG_WARNING, "Failed to get main window");
+        return;
+    }
+
+    QElapsedTimer applyTimer;
+    applyTimer.start();
+
+    // Qt would keep placeholders for docks that did not show up in time
+    QByteArray windowState = layout.windowState;
+    const QStringList stripped = LayoutSwitcher::stripMissingDocks(main_window, windowState);
+    const bool restored = main_window->restoreState(windowState);
+    Diagnostics::record(Diagnostics::Phase::Apply, applyTimer.nsecsElapsed());
+
+    if (!restored) {
+        blog(LOG_WARNING, "Failed to restore default dock layout '%s'", layout.name.toUtf8().constData());
+        return;
+    }
+
+    // Lets automatic switching skip this layout while it is shown
+    if (RestoreScheduler *scheduler = RestoreScheduler::instance()) {
+        scheduler->setCurrentLayout(layout.name);
+    }
+
+    DockSuspender::instance().applyLayout(layout.name);
+
+    if (!stripped.isEmpty()) {
+        blog(LOG_INFO, "Left missing docks out of default dock layout '%s': %s", layout.name.toUtf8().constData(),
+             stripped.join(", ").toUtf8().constData());
+    }
+    blog(LOG_INFO, "Default dock layout '%s' restored successfully (load %.2f ms, apply %.2f ms)",
+         layout.name.toUtf8().constData(), layout.prepareNs / 1e6, applyTimer.nsecsElapsed() / 1e6);
+}
+
+// Restore the default layout as soon as every dock it places exists
 void restore_default_layout()
 {
     void *main_window_handle = obs_frontend_get_main_window();
@@ -469,39 +869,111 @@ void restore_default_layout()
         return;
     }
 
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-    settings.beginGroup("Settings");
-    QString defaultLayoutName = settings.value("DefaultLayout").toString();
-    settings.endGroup();
+    // Normally finished long ago; only blocks if loading OBS was faster
+    const QString screenKey = ScreenConfig::instance().currentKey();
+    PreparedLayout layout = preparedDefaultLayout.valid() ? preparedDefaultLayout.get() : prepare_default_layout(screenKey);
 
-    if (defaultLayoutName.isEmpty()) {
+    // Screens changed while OBS was loading
+    if (layout.screenKey != screenKey && !layout.name.isEmpty()) {
+        layout = prepare_default_layout(screenKey);
+    }
+
+    if (layout.name.isEmpty()) {
         blog(LOG_INFO, "No default layout set");
         return;
     }
 
-    settings.beginGroup(defaultLayoutName);
-    QByteArray windowState = settings.value("WindowState").toByteArray();
-    settings.endGroup();
+    if (!layout.valid) {
+        blog(LOG_WARNING, "Default layout '%s' %s", layout.name.toUtf8().constData(), layout.error.toUtf8().constData());
+        return;
+    }
 
-    if (!windowState.isEmpty()) {
-        if (!main_window->restoreState(windowState)) {
-            blog(LOG_WARNING, "Failed to restore default dock layout '%s'", defaultLayoutName.toUtf8().constData());
-            return;
+    if (!layout.dockNamesKnown) {
+        blog(LOG_WARNING, "Could not read the docks of default layout '%s'", layout.name.toUtf8().constData());
+    }
+
+    // Docks the last session did not have either, such as those of removed
+    // plugins, would only hold the restore up until the deadline
+    QStringList expectedDocks = layout.dockNames;
+    QSet<QString> sessionDocks;
+    if (DockIndex::lastSessionDocks(sessionDocks)) {
+        QStringList absentDocks;
+        for (const QString &dockName : layout.dockNames) {
+            if (!sessionDocks.contains(dockName)) {
+                absentDocks.append(dockName);
+                expectedDocks.removeAll(dockName);
+            }
         }
-    } else {
-        blog(LOG_WARNING, "Default layout '%s' does not contain valid window state", defaultLayoutName.toUtf8().constData());
+        if (!absentDocks.isEmpty()) {
+            blog(LOG_INFO, "Not waiting for docks of default layout '%s' missing in the last session: %s",
+                 layout.name.toUtf8().constData(), absentDocks.join(", ").toUtf8().constData());
+        }
+    }
+
+    DockReadinessWatcher *watcher = new DockReadinessWatcher(main_window, expectedDocks, restore_deadline_ms());
+    QObject::connect(watcher, &DockReadinessWatcher::finished, watcher, [watcher, layout, expectedDocks](bool allDocksReady) {
+        if (allDocksReady) {
+            blog(LOG_INFO, "Waited %lld ms for all %d expected docks of default layout '%s'", watcher->elapsedMs(),
+                 int(expectedDocks.size()), layout.name.toUtf8().constData());
+        } else {
+            blog(LOG_WARNING, "Gave up waiting for docks of default layout '%s' after %lld ms (deadline %d ms), missing: %s",
+                 layout.name.toUtf8().constData(), watcher->elapsedMs(), watcher->deadlineMs(),
+                 watcher->missingDocks().join(", ").toUtf8().constData());
+        }
+
+        apply_default_layout(layout);
+    });
+    watcher->start();
+}
+
+// Moves the shown layout to its variant for the new screens, if it has one
+static void on_screens_changed(const QString &screenKey)
+{
+    RestoreScheduler *scheduler = RestoreScheduler::instance();
+    if (!scheduler) {
         return;
     }
 
-    blog(LOG_INFO, "Default dock layout '%s' restored successfully", defaultLayoutName.toUtf8().constData());
+    QString layoutName = scheduler->currentLayout();
+    LayoutStore &store = LayoutStore::instance();
+    if (layoutName.isEmpty() || !store.hasWindowStateVariant(layoutName, screenKey)) {
+        return;
+    }
+
+    blog(LOG_INFO, "Switching to the variant of dock layout '%s' for screens %s", layoutName.toUtf8().constData(),
+         screenKey.toUtf8().constData());
+    scheduler->switchTo(layoutName, store.windowState(layoutName, screenKey));
 }
 
 // Frontend event callback
 void on_frontend_event(enum obs_frontend_event event, void *private_data)
 {
     if (event == OBS_FRONTEND_EVENT_FINISHED_LOADING) {
-        // Delay the restoration to ensure all docks are loaded
-        QTimer::singleShot(500, restore_default_layout); // Delay of 500 milliseconds
+        // Waits for the layout's docks instead of a fixed delay
+        restore_default_layout();
+
+        // Scene changes while loading are left to the default layout
+        LayoutRules::instance().start();
+        DockSuspender::instance().follow();
+        LayoutHistory::instance().start(static_cast<QMainWindow *>(obs_frontend_get_main_window()));
+        LayoutApi::instance().start(static_cast<QMainWindow *>(obs_frontend_get_main_window()),
+                                    RestoreScheduler::instance());
+        DockIndex::instance().start(static_cast<QMainWindow *>(obs_frontend_get_main_window()));
+        LayoutSearch::instance().follow();
+
+        // Screen changes are reported by Qt, nothing is polled
+        QObject::connect(&ScreenConfig::instance(), &ScreenConfig::changed, &ScreenConfig::instance(), on_screens_changed);
+    } else if (event == OBS_FRONTEND_EVENT_EXIT) {
+        LayoutRules::instance().stop();
+        DockIndex::instance().saveSessionDocks();
+
+        // Hotkeys must be saved while OBS still knows their bindings
+        LayoutHotkeys::instance().saveBindings();
+        LayoutHotkeys::instance().unregisterAll();
+        LayoutHistory::instance().saveBindings();
+        LayoutHistory::instance().unregisterHotkeys();
+    } else {
+        LayoutRules::instance().handleFrontendEvent(event);
     }
 }
 
@@ -532,9 +1004,10 @@ bool obs_module_load(void)
     QFileInfo moduleFileInfo(moduleFilePath);
     QString moduleDir = moduleFileInfo.absolutePath();
     settingsFilePath = QDir::cleanPath(moduleDir + QDir::separator() + "obs-auto-dock-profiles.ini"); // Added .ini extension
+    databaseFilePath = QDir::cleanPath(moduleDir + QDir::separator() + "obs-dock-layouts.db");
 
-    // Log the settings file path
-    blog(LOG_INFO, "Settings file path: %s", settingsFilePath.toUtf8().constData());
+    // Log the layout database path
+    blog(LOG_INFO, "Layout database path: %s", databaseFilePath.toUtf8().constData());
 
     // Ensure the settings file exists
     QDir dir(moduleDir);
@@ -542,6 +1015,21 @@ bool obs_module_load(void)
         dir.mkpath(".");
     }
 
+    // Only the database index is read here; layouts are mapped in on demand
+    LayoutStore::instance().load(databaseFilePath, settingsFilePath);
+    LayoutThumbnails::instance().setCacheDirectory(QDir::cleanPath(moduleDir + QDir::separator() + "thumbnails"));
+
+    // One hotkey per layout, bound in OBS's hotkey settings
+    LayoutHotkeys::instance().registerAll();
+    LayoutHistory::instance().registerHotkeys();
+
+    // Procedures for scripts and show control tools
+    LayoutApi::instance().registerProcs();
+
+    // Decode the default layout while the rest of OBS loads; screens can
+    // only be queried from this thread
+    preparedDefaultLayout = std::async(std::launch::async, prepare_default_layout, ScreenConfig::instance().currentKey());
+
     // Add the plugin to the Tools menu
     obs_frontend_push_ui_translation(obs_module_get_string);
     obs_frontend_add_tools_menu_item("Dock Layout Manager", show_dock_layout_manager, nullptr);
@@ -561,5 +1049,18 @@ void obs_module_unload(void)
         dockListDialog = nullptr;
     }
 
+    // The worker reads from the store, so it has to be done first
+    if (preparedDefaultLayout.valid()) {
+        preparedDefaultLayout.wait();
+    }
+    LayoutThumbnails::instance().shutdown();
+    LayoutBundle::shutdown();
+
+    // Make sure no pending layout change is lost
+    LayoutStore::instance().shutdown();
+
+    // Includes the final disk sync from shutdown()
+    blog(LOG_INFO, "Dock layout timings: %s", Diagnostics::summary().toUtf8().constData());
+
     blog(LOG_INFO, "%s plugin unloaded", PLUGIN_NAME);
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "prepared-layout.hpp"
+#include "layout-store.hpp"
+#include "window-state.hpp"
+
+#include <QElapsedTimer>
+
+PreparedLayout PreparedLayout::prepare(const QString &name, const QString &screenKey)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    PreparedLayout layout;
+    layout.name = name;
+    layout.screenKey = screenKey;
+    layout.windowState = LayoutStore::instance().windowState(name, screenKey);
+
+    if (layout.windowState.isEmpty()) {
+        layout.error = QStringLiteral("does not contain valid window state");
+    } else {
+        // An unreadable state is still handed to restoreState, which gets
+        // the final say
+        layout.dockNamesKnown = WindowState::dockNames(layout.windowState, layout.dockNames);
+        if (!layout.dockNamesKnown)
+            layout.dockNames.clear();
+        layout.valid = true;
+    }
+
+    layout.prepareNs = timer.nsecsElapsed();
+    return layout;
+}
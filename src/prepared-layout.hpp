@@ -0,0 +1,26 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// A layout that has been read from the store and validated, so applying it
+// only has to hand the state to QMainWindow::restoreState()
+struct PreparedLayout {
+    QString name;
+    QString screenKey; // Screen configuration the variant was picked for
+    QByteArray windowState;
+    QStringList dockNames;
+    bool dockNamesKnown = false; // False if the state could not be parsed
+    bool valid = false;
+    QString error;               // Why the layout is not valid
+    qint64 prepareNs = 0; // Time spent reading and decoding
+
+    // Reads and validates the layout's variant for screenKey; safe to
+    // call from any thread
+    static PreparedLayout prepare(const QString &name, const QString &screenKey);
+};
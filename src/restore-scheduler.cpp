@@ -0,0 +1,209 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "restore-scheduler.hpp"
+#include "diagnostics.hpp"
+#include "layout-store.hpp"
+
+#include <obs-module.h>
+#include <obs-frontend-api.h>
+
+static QPointer<RestoreScheduler> sharedScheduler;
+
+RestoreScheduler *RestoreScheduler::instance()
+{
+    if (!sharedScheduler) {
+        QMainWindow *mainWindow = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+        if (!mainWindow)
+            return nullptr;
+        sharedScheduler = new RestoreScheduler(mainWindow);
+    }
+
+    sharedScheduler->setSliceBudgetUs(sliceBudgetSettingUs());
+    return sharedScheduler;
+}
+
+int RestoreScheduler::sliceBudgetSettingUs()
+{
+    bool ok;
+    int budgetUs = LayoutStore::instance().setting(QStringLiteral("RestoreSliceBudgetUs")).toInt(&ok);
+    return ok && budgetUs > 0 ? budgetUs : defaultSliceBudgetUs;
+}
+
+RestoreScheduler::RestoreScheduler(QMainWindow *mainWindow) : QObject(mainWindow), mainWindow(mainWindow)
+{
+    // Zero interval: the next slice runs once pending events are handled
+    sliceTimer.setSingleShot(true);
+    sliceTimer.setInterval(0);
+    connect(&sliceTimer, &QTimer::timeout, this, &RestoreScheduler::runSlice);
+
+    LayoutStore &store = LayoutStore::instance();
+    connect(&store, &LayoutStore::layoutRenamed, this, [this](const QString &oldName, const QString &newName) {
+        if (currentName == oldName)
+            currentName = newName;
+        if (finishedCurrent == oldName)
+            finishedCurrent = newName;
+    });
+    connect(&store, &LayoutStore::layoutRemoved, this, [this](const QString &name) {
+        if (currentName == name)
+            currentName.clear();
+        if (finishedCurrent == name)
+            finishedCurrent.clear();
+    });
+}
+
+void RestoreScheduler::switchTo(const QString &name, const QByteArray &windowState)
+{
+    if (!mainWindow)
+        return;
+
+    begin(name);
+    currentName = name;
+    targetState = windowState;
+    runSlice();
+}
+
+void RestoreScheduler::applyPlan(const QString &name, const LayoutSwitcher::Plan &changes, const QString &current)
+{
+    if (!mainWindow)
+        return;
+
+    begin(name);
+    finishedCurrent = current;
+    plan = changes;
+    planned = true;
+    runSlice();
+}
+
+void RestoreScheduler::applySnapshot(const QByteArray &windowState)
+{
+    if (!mainWindow)
+        return;
+
+    begin(QStringLiteral("history step"));
+    snapshot = true;
+    targetState = windowState;
+    runSlice();
+}
+
+void RestoreScheduler::begin(const QString &name)
+{
+    // The new plan diffs against whatever the old switch already applied;
+    // updates are still suppressed from it
+    const bool superseding = running;
+    if (superseding) {
+        blog(LOG_INFO, "Dock layout switch to '%s' superseded by '%s'", layoutName.toUtf8().constData(),
+             name.toUtf8().constData());
+        sliceTimer.stop();
+    } else {
+        updatesWereEnabled = mainWindow->updatesEnabled();
+        mainWindow->setUpdatesEnabled(false);
+    }
+
+    running = true;
+    planned = false;
+    snapshot = false;
+    layoutName = name;
+    finishedCurrent.clear();
+    targetState.clear();
+    plan = LayoutSwitcher::Plan();
+    nextChange = 0;
+    slices = 0;
+    peakSliceNs = 0;
+    busyNs = 0;
+    switchTimer.start();
+}
+
+void RestoreScheduler::runSlice()
+{
+    if (!running)
+        return;
+    if (!mainWindow) {
+        finish(false);
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+
+    // Diffing is part of the first slice
+    if (!planned) {
+        plan = LayoutSwitcher::plan(mainWindow, targetState);
+        planned = true;
+    }
+
+    bool ok = true;
+    if (plan.fullRestore && slices == 0) {
+        ok = mainWindow->restoreState(plan.targetState);
+        if (!ok)
+            nextChange = int(plan.changes.size());
+    }
+    while (nextChange < plan.changes.size()) {
+        LayoutSwitcher::applyChange(mainWindow, plan.changes[nextChange++]);
+        if (slice.nsecsElapsed() >= sliceBudgetNs)
+            break;
+    }
+
+    const qint64 sliceNs = slice.nsecsElapsed();
+    ++slices;
+    peakSliceNs = qMax(peakSliceNs, sliceNs);
+    busyNs += sliceNs;
+
+    if (nextChange < plan.changes.size()) {
+        sliceTimer.start();
+        return;
+    }
+
+    finish(ok);
+}
+
+void RestoreScheduler::finish(bool ok)
+{
+    sliceTimer.stop();
+    running = false;
+    if (!snapshot && !ok && currentName == layoutName)
+        currentName.clear();
+    if (!snapshot && ok && !finishedCurrent.isEmpty())
+        currentName = finishedCurrent;
+
+    if (mainWindow) {
+        // The single repaint of the whole switch, done right away so that
+        // it can be timed
+        QElapsedTimer repaintTimer;
+        repaintTimer.start();
+        mainWindow->setUpdatesEnabled(updatesWereEnabled);
+        mainWindow->repaint();
+        Diagnostics::record(Diagnostics::Phase::Repaint, repaintTimer.nsecsElapsed());
+    }
+    lastSwitchNs = switchTimer.nsecsElapsed();
+
+    if (planned && ok) {
+        // Only the time OBS was blocked, not the gaps between slices
+        Diagnostics::record(Diagnostics::Phase::Apply, busyNs);
+
+        if (!plan.missingDocks.isEmpty()) {
+            blog(LOG_INFO, "Dock layout '%s' places docks that do not exist, left out: %s",
+                 layoutName.toUtf8().constData(), plan.missingDocks.join(", ").toUtf8().constData());
+        }
+
+        if (snapshot) {
+            blog(LOG_INFO, "Applied dock history step in %.2f ms (%s, peak slice %.2f ms)",
+                 switchTimer.nsecsElapsed() / 1e6,
+                 plan.fullRestore ? "full restore" : "incremental", peakSliceNs / 1e6);
+        } else if (plan.fullRestore) {
+            blog(LOG_INFO, "Restored dock layout '%s' in %.2f ms (full restore: %s, peak slice %.2f ms)",
+                 layoutName.toUtf8().constData(), switchTimer.nsecsElapsed() / 1e6,
+                 plan.reason.toUtf8().constData(), peakSliceNs / 1e6);
+        } else {
+            blog(LOG_INFO, "Switched to dock layout '%s' in %.2f ms (%d docks changed, %d slices, peak slice %.2f ms)",
+                 layoutName.toUtf8().constData(), switchTimer.nsecsElapsed() / 1e6, plan.changedDocks, slices,
+                 peakSliceNs / 1e6);
+        }
+    }
+
+    if (snapshot)
+        emit snapshotApplied(ok);
+    else
+        emit finished(layoutName, ok);
+}
@@ -0,0 +1,92 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include "layout-switcher.hpp"
+
+#include <QElapsedTimer>
+#include <QMainWindow>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+// Applies layout switches in slices that yield to the event loop.
+//
+// The per-dock changes of a LayoutSwitcher plan are run until the slice
+// budget is used up, then the scheduler returns to the event loop so OBS can
+// paint its preview and handle input before the next slice. Window updates
+// stay suppressed for the whole switch, which ends with a single repaint.
+// A full restoreState() cannot be split and always runs as one slice;
+// changes planned after it follow in the usual slices.
+// The busy time and the repaint are recorded in Diagnostics.
+class RestoreScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int defaultSliceBudgetUs = 4000;
+
+    // Shared scheduler of the OBS main window, created on first use with
+    // the budget from the RestoreSliceBudgetUs setting
+    static RestoreScheduler *instance();
+    static int sliceBudgetSettingUs();
+
+    explicit RestoreScheduler(QMainWindow *mainWindow);
+
+    // Starts switching to a layout; a switch still in progress is
+    // superseded. The first slice runs before this returns.
+    void switchTo(const QString &name, const QByteArray &windowState);
+
+    // Runs a plan made elsewhere, e.g. of partial layouts, the same way.
+    // If it finishes successfully the current layout becomes `current`, or
+    // stays what it was if that is empty.
+    void applyPlan(const QString &name, const LayoutSwitcher::Plan &changes, const QString &current = QString());
+
+    // Moves the docks to a state of no saved layout, such as an undo step.
+    // The current layout stays, and snapshotApplied() is emitted instead of
+    // finished().
+    void applySnapshot(const QByteArray &windowState);
+
+    void setSliceBudgetUs(int budgetUs) { sliceBudgetNs = qint64(budgetUs) * 1000; }
+    bool isRunning() const { return running; }
+
+    // Layout the window shows or is switching to; empty after a failed
+    // switch. Follows renames and removals in the store.
+    QString currentLayout() const { return currentName; }
+    void setCurrentLayout(const QString &name) { currentName = name; }
+
+    // Time from start to repaint of the switch that finished last
+    qint64 lastDurationNs() const { return lastSwitchNs; }
+
+signals:
+    void finished(const QString &name, bool ok);
+    void snapshotApplied(bool ok);
+
+private:
+    void begin(const QString &name);
+    void runSlice();
+    void finish(bool ok);
+
+    QPointer<QMainWindow> mainWindow;
+    QTimer sliceTimer;
+    QString currentName;
+    qint64 sliceBudgetNs = qint64(defaultSliceBudgetUs) * 1000;
+
+    // State of the switch in progress
+    bool running = false;
+    bool planned = false;
+    bool snapshot = false; // From applySnapshot()
+    bool updatesWereEnabled = true;
+    QString layoutName;
+    QString finishedCurrent; // Current layout once an applied plan succeeds
+    QByteArray targetState;
+    LayoutSwitcher::Plan plan;
+    int nextChange = 0;
+    int slices = 0;
+    qint64 peakSliceNs = 0;
+    qint64 busyNs = 0; // Sum of all slices
+    QElapsedTimer switchTimer;
+    qint64 lastSwitchNs = 0;
+};
@@ -0,0 +1,140 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "rules-view.hpp"
+#include "layout-rules.hpp"
+#include "layout-store.hpp"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QVBoxLayout>
+
+RulesView::RulesView(QWidget *parent) : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    table = new QTableWidget(0, 3, this);
+    table->setHorizontalHeaderLabels({"Event", "Name", "Layout"});
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    layout->addWidget(table);
+
+    // A new rule: event, optional name pattern, target layout
+    QHBoxLayout *ruleLayout = new QHBoxLayout;
+
+    triggerCombo = new QComboBox(this);
+    for (int index = 0; index < LayoutRules::triggerCount; ++index)
+        triggerCombo->addItem(LayoutRules::triggerLabel(LayoutRules::Trigger(index)), index);
+    connect(triggerCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &RulesView::updateNameEdit);
+    ruleLayout->addWidget(triggerCombo);
+
+    nameEdit = new QLineEdit(this);
+    nameEdit->setPlaceholderText("Any name");
+    nameEdit->setToolTip("Scene, profile or scene collection name; * and ? match any text");
+    ruleLayout->addWidget(nameEdit);
+
+    layoutCombo = new QComboBox(this);
+    ruleLayout->addWidget(layoutCombo);
+
+    QPushButton *addButton = new QPushButton("Add", this);
+    addButton->setToolTip("Switch to the layout when the event happens");
+    connect(addButton, &QPushButton::clicked, this, &RulesView::addRule);
+    ruleLayout->addWidget(addButton);
+
+    QPushButton *removeButton = new QPushButton("Remove", this);
+    removeButton->setToolTip("Remove the selected rule");
+    connect(removeButton, &QPushButton::clicked, this, &RulesView::removeRule);
+    ruleLayout->addWidget(removeButton);
+
+    layout->addLayout(ruleLayout);
+
+    // Rapid scene cuts only switch once things settle
+    QHBoxLayout *debounceLayout = new QHBoxLayout;
+    debounceLayout->addWidget(new QLabel("Wait before switching automatically:", this));
+    QSpinBox *debounceSpinBox = new QSpinBox(this);
+    debounceSpinBox->setRange(0, 10000);
+    debounceSpinBox->setSingleStep(50);
+    debounceSpinBox->setSuffix(" ms");
+    debounceSpinBox->setValue(LayoutRules::instance().debounceMs());
+    debounceSpinBox->setToolTip("Only the last of several events within this time switches the layout");
+    connect(debounceSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+            [](int milliseconds) { LayoutRules::instance().setDebounceMs(milliseconds); });
+    debounceLayout->addWidget(debounceSpinBox);
+    debounceLayout->addStretch();
+    layout->addLayout(debounceLayout);
+
+    updateNameEdit();
+}
+
+void RulesView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+}
+
+void RulesView::refresh()
+{
+    const QString selectedLayout = layoutCombo->currentText();
+    layoutCombo->clear();
+    layoutCombo->addItems(LayoutStore::instance().layoutNames());
+    layoutCombo->setCurrentText(selectedLayout);
+
+    const QVector<LayoutRules::Rule> rules = LayoutRules::instance().rules();
+    table->setRowCount(int(rules.size()));
+    for (int row = 0; row < rules.size(); ++row) {
+        const LayoutRules::Rule &rule = rules[row];
+        table->setItem(row, 0, new QTableWidgetItem(LayoutRules::triggerLabel(rule.trigger)));
+        table->setItem(row, 1, new QTableWidgetItem(rule.pattern.isEmpty() && LayoutRules::triggerHasName(rule.trigger)
+                                                        ? QStringLiteral("Any")
+                                                        : rule.pattern));
+        table->setItem(row, 2, new QTableWidgetItem(rule.layout));
+    }
+}
+
+void RulesView::addRule()
+{
+    if (layoutCombo->currentText().isEmpty()) {
+        QMessageBox::warning(this, "Error", "Please create a layout first.");
+        return;
+    }
+
+    LayoutRules::Rule rule;
+    rule.trigger = LayoutRules::Trigger(triggerCombo->currentData().toInt());
+    rule.pattern = LayoutRules::triggerHasName(rule.trigger) ? nameEdit->text().trimmed() : QString();
+    rule.layout = layoutCombo->currentText();
+
+    QVector<LayoutRules::Rule> rules = LayoutRules::instance().rules();
+    rules.append(rule);
+    LayoutRules::instance().setRules(rules);
+
+    nameEdit->clear();
+    refresh();
+}
+
+void RulesView::removeRule()
+{
+    const int row = table->currentRow();
+    QVector<LayoutRules::Rule> rules = LayoutRules::instance().rules();
+    if (row < 0 || row >= rules.size() || table->selectedItems().isEmpty()) {
+        QMessageBox::warning(this, "Error", "Please select a rule to remove.");
+        return;
+    }
+
+    rules.removeAt(row);
+    LayoutRules::instance().setRules(rules);
+    refresh();
+}
+
+void RulesView::updateNameEdit()
+{
+    // Streaming and recording have no name to match
+    nameEdit->setEnabled(LayoutRules::triggerHasName(LayoutRules::Trigger(triggerCombo->currentData().toInt())));
+}
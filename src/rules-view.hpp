@@ -0,0 +1,33 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QComboBox>
+#include <QLineEdit>
+#include <QTableWidget>
+#include <QWidget>
+
+// "Rules" tab of the layout dialog, editing the LayoutRules table
+class RulesView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit RulesView(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private:
+    void refresh();
+    void addRule();
+    void removeRule();
+    void updateNameEdit();
+
+    QTableWidget *table;
+    QComboBox *triggerCombo;
+    QLineEdit *nameEdit;
+    QComboBox *layoutCombo;
+};
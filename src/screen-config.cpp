@@ -0,0 +1,85 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "screen-config.hpp"
+
+#include <obs-module.h>
+
+#include <QCryptographicHash>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QStringList>
+
+#include <algorithm>
+
+// Docking a laptop removes and adds several screens in a row
+static constexpr int settleDelayMs = 250;
+
+ScreenConfig &ScreenConfig::instance()
+{
+    static ScreenConfig config;
+    return config;
+}
+
+ScreenConfig::ScreenConfig()
+{
+    key = computeKey();
+
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(settleDelayMs);
+    connect(&settleTimer, &QTimer::timeout, this, &ScreenConfig::recompute);
+
+    QGuiApplication *application = qobject_cast<QGuiApplication *>(QCoreApplication::instance());
+    if (!application)
+        return;
+
+    connect(application, &QGuiApplication::screenAdded, this, [this](QScreen *screen) {
+        watchScreen(screen);
+        settleTimer.start();
+    });
+    connect(application, &QGuiApplication::screenRemoved, this, [this](QScreen *) { settleTimer.start(); });
+    for (QScreen *screen : QGuiApplication::screens())
+        watchScreen(screen);
+}
+
+QString ScreenConfig::computeKey()
+{
+    QStringList screens;
+    for (QScreen *screen : QGuiApplication::screens()) {
+        const QRect geometry = screen->geometry();
+        screens.append(QStringLiteral("%1,%2,%3x%4@%5/%6")
+                           .arg(geometry.x())
+                           .arg(geometry.y())
+                           .arg(geometry.width())
+                           .arg(geometry.height())
+                           .arg(screen->devicePixelRatio())
+                           .arg(screen->logicalDotsPerInch()));
+    }
+
+    // The order of QGuiApplication::screens() is not stable across restarts
+    std::sort(screens.begin(), screens.end());
+
+    const QByteArray digest = QCryptographicHash::hash(screens.join(QLatin1Char(';')).toUtf8(), QCryptographicHash::Sha1);
+    return QString::fromLatin1(digest.left(8).toHex());
+}
+
+void ScreenConfig::watchScreen(QScreen *screen)
+{
+    // Resolution and scaling changes count as a different arrangement too
+    connect(screen, &QScreen::geometryChanged, &settleTimer, qOverload<>(&QTimer::start), Qt::UniqueConnection);
+    connect(screen, &QScreen::logicalDotsPerInchChanged, &settleTimer, qOverload<>(&QTimer::start),
+            Qt::UniqueConnection);
+}
+
+void ScreenConfig::recompute()
+{
+    const QString newKey = computeKey();
+    if (newKey == key)
+        return;
+
+    blog(LOG_INFO, "Screen configuration changed from %s to %s", key.toUtf8().constData(),
+         newKey.toUtf8().constData());
+    key = newKey;
+    emit changed(key);
+}
@@ -0,0 +1,43 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+class QScreen;
+
+// Identifies the current monitor arrangement.
+//
+// The key is a short hash of every screen's geometry, pixel ratio and DPI,
+// recomputed only when Qt reports a screen being added, removed or changed,
+// so reading it is free. Layouts store a window state per key (see
+// LayoutStore::windowState), so the variant for the current screens is a
+// single lookup.
+class ScreenConfig : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ScreenConfig &instance();
+
+    // UI thread only
+    QString currentKey() const { return key; }
+
+signals:
+    // Emitted once a burst of screen events has settled and the key differs
+    void changed(const QString &key);
+
+private:
+    ScreenConfig();
+
+    static QString computeKey();
+    void watchScreen(QScreen *screen);
+    void recompute();
+
+    QString key;
+    QTimer settleTimer;
+};
@@ -0,0 +1,275 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "window-state.hpp"
+
+#include <QDataStream>
+
+using namespace WindowState;
+
+// Markers written by QMainWindow, QDockAreaLayout and QDockAreaLayoutInfo
+static constexpr qint32 versionMarker = 0xff;
+static constexpr quint8 dockWidgetStateMarker = 0xfd;
+static constexpr quint8 floatingDockWidgetTabMarker = 0xf9;
+static constexpr quint8 sequenceMarker = 0xfc;
+static constexpr quint8 tabMarker = 0xfa;
+static constexpr quint8 widgetMarker = 0xfb;
+static constexpr quint8 stateFlagVisible = 1;
+static constexpr quint8 stateFlagFloating = 2;
+
+// Dock area layouts nest one level per splitter, so this is generous
+static constexpr int maxNestingDepth = 32;
+
+// saveState() always streams with this version
+static constexpr QDataStream::Version streamVersion = QDataStream::Qt_5_0;
+
+static bool readGroup(QDataStream &stream, State &state, qint32 parent, qint32 area, int depth)
+{
+    if (depth > maxNestingDepth)
+        return false;
+
+    const qint32 groupIndex = qint32(state.groups.size());
+    state.groups.append(Group());
+    state.groups[groupIndex].parent = parent;
+    state.groups[groupIndex].area = area;
+
+    quint8 marker;
+    stream >> marker;
+    if (marker == tabMarker) {
+        state.groups[groupIndex].tabbed = true;
+        stream >> state.groups[groupIndex].currentTab;
+    } else if (marker != sequenceMarker) {
+        return false;
+    }
+
+    qint32 itemCount;
+    stream >> state.groups[groupIndex].orientation >> itemCount;
+    if (stream.status() != QDataStream::Ok || itemCount < 0)
+        return false;
+
+    for (qint32 i = 0; i < itemCount; ++i) {
+        quint8 itemMarker;
+        stream >> itemMarker;
+
+        if (itemMarker == widgetMarker) {
+            DockRecord dock;
+            quint8 flags;
+            stream >> dock.objectName >> flags;
+            dock.area = area;
+            dock.group = groupIndex;
+            dock.tabGroup = state.groups[groupIndex].tabbed ? groupIndex : -1;
+            dock.visible = flags & stateFlagVisible;
+            dock.floating = flags & stateFlagFloating;
+
+            if (dock.floating) {
+                qint32 x, y, width, height;
+                stream >> x >> y >> width >> height;
+                dock.geometry = QRect(x, y, width, height);
+            } else {
+                stream >> dock.pos >> dock.size >> dock.minimumSize >> dock.maximumSize;
+            }
+
+            state.groups[groupIndex].items.append({false, qint32(state.docks.size())});
+            state.docks.append(dock);
+        } else if (itemMarker == sequenceMarker) {
+            qint32 pos, size, minimumSize, maximumSize;
+            stream >> pos >> size >> minimumSize >> maximumSize;
+
+            const qint32 childIndex = qint32(state.groups.size());
+            if (!readGroup(stream, state, groupIndex, area, depth + 1))
+                return false;
+
+            Group &child = state.groups[childIndex];
+            child.pos = pos;
+            child.size = size;
+            child.minimumSize = minimumSize;
+            child.maximumSize = maximumSize;
+            state.groups[groupIndex].items.append({true, childIndex});
+        } else {
+            return false;
+        }
+
+        if (stream.status() != QDataStream::Ok)
+            return false;
+    }
+
+    return true;
+}
+
+static void writeGroup(QDataStream &stream, const State &state, qint32 groupIndex)
+{
+    const Group &group = state.groups[groupIndex];
+
+    if (group.tabbed)
+        stream << tabMarker << group.currentTab;
+    else
+        stream << sequenceMarker;
+    stream << group.orientation << qint32(group.items.size());
+
+    for (const Group::Item &item : group.items) {
+        if (item.isGroup) {
+            const Group &child = state.groups[item.index];
+            stream << sequenceMarker << child.pos << child.size << child.minimumSize << child.maximumSize;
+            writeGroup(stream, state, item.index);
+            continue;
+        }
+
+        const DockRecord &dock = state.docks[item.index];
+        quint8 flags = 0;
+        if (dock.visible)
+            flags |= stateFlagVisible;
+        if (dock.floating)
+            flags |= stateFlagFloating;
+
+        stream << widgetMarker << dock.objectName << flags;
+        if (dock.floating) {
+            stream << qint32(dock.geometry.x()) << qint32(dock.geometry.y()) << qint32(dock.geometry.width())
+                   << qint32(dock.geometry.height());
+        } else {
+            stream << dock.pos << dock.size << dock.minimumSize << dock.maximumSize;
+        }
+    }
+}
+
+int State::findDock(const QString &objectName) const
+{
+    for (int i = 0; i < docks.size(); ++i) {
+        if (docks[i].objectName == objectName)
+            return i;
+    }
+    return -1;
+}
+
+bool WindowState::parse(const QByteArray &data, State &state)
+{
+    state = State();
+
+    QDataStream stream(data);
+    stream.setVersion(streamVersion);
+
+    qint32 marker, areaCount;
+    quint8 areaMarker;
+    stream >> marker >> state.version >> areaMarker >> areaCount;
+    if (stream.status() != QDataStream::Ok || marker != versionMarker || areaMarker != dockWidgetStateMarker ||
+        areaCount < 0 || areaCount > 4)
+        return false;
+
+    for (qint32 i = 0; i < areaCount; ++i) {
+        State::Area area;
+        stream >> area.area >> area.size;
+        if (stream.status() != QDataStream::Ok || area.area < LeftArea || area.area > BottomArea)
+            return false;
+
+        area.group = qint32(state.groups.size());
+        if (!readGroup(stream, state, -1, area.area, 0))
+            return false;
+        state.areas.append(area);
+    }
+
+    stream >> state.centralSize;
+    for (qint32 &corner : state.corners)
+        stream >> corner;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    // Floating tab groups, then the toolbar section which is kept as is
+    for (;;) {
+        const qint64 position = stream.device()->pos();
+        quint8 nextMarker;
+        stream >> nextMarker;
+        if (stream.status() != QDataStream::Ok || nextMarker != floatingDockWidgetTabMarker) {
+            state.trailer = data.mid(position);
+            break;
+        }
+
+        State::FloatingWindow window;
+        stream >> window.geometry;
+        window.group = qint32(state.groups.size());
+        if (!readGroup(stream, state, -1, FloatingArea, 0))
+            return false;
+        state.floatingWindows.append(window);
+    }
+
+    return true;
+}
+
+QByteArray WindowState::serialize(const State &state)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(streamVersion);
+
+    stream << versionMarker << state.version << dockWidgetStateMarker << qint32(state.areas.size());
+    for (const State::Area &area : state.areas) {
+        stream << area.area << area.size;
+        writeGroup(stream, state, area.group);
+    }
+
+    stream << state.centralSize;
+    for (qint32 corner : state.corners)
+        stream << corner;
+
+    for (const State::FloatingWindow &window : state.floatingWindows) {
+        stream << floatingDockWidgetTabMarker << window.geometry;
+        writeGroup(stream, state, window.group);
+    }
+
+    stream.writeRawData(state.trailer.constData(), int(state.trailer.size()));
+    return data;
+}
+
+int WindowState::removeDocks(State &state, const QSet<QString> &objectNames)
+{
+    int removed = 0;
+    QVector<bool> emptyGroup(state.groups.size(), false);
+
+    // Groups are stored parents first, so walking backwards sees every
+    // child group before its parent
+    for (int i = int(state.groups.size()) - 1; i >= 0; --i) {
+        Group &group = state.groups[i];
+        QVector<Group::Item> kept;
+        kept.reserve(group.items.size());
+        int currentTab = group.currentTab;
+        for (int j = 0; j < group.items.size(); ++j) {
+            const Group::Item &item = group.items[j];
+            const bool drop = item.isGroup ? emptyGroup[item.index]
+                                           : objectNames.contains(state.docks[item.index].objectName);
+            if (!drop) {
+                kept.append(item);
+                continue;
+            }
+            if (!item.isGroup)
+                ++removed;
+            if (j < group.currentTab)
+                --currentTab;
+        }
+
+        if (kept.size() == group.items.size())
+            continue;
+        group.items = kept;
+        if (group.tabbed)
+            group.currentTab = qBound(0, currentTab, qMax(0, int(kept.size()) - 1));
+        emptyGroup[i] = kept.isEmpty();
+    }
+
+    // An empty area root stays, Qt reads it as an empty area
+    for (int i = int(state.floatingWindows.size()) - 1; i >= 0; --i) {
+        if (emptyGroup[state.floatingWindows[i].group])
+            state.floatingWindows.removeAt(i);
+    }
+    return removed;
+}
+
+bool WindowState::dockNames(const QByteArray &data, QStringList &names)
+{
+    State state;
+    if (!parse(data, state))
+        return false;
+
+    names.clear();
+    names.reserve(state.docks.size());
+    for (const DockRecord &dock : state.docks)
+        names.append(dock.objectName);
+    return true;
+}
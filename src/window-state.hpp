@@ -0,0 +1,111 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QRect>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Structured access to the blobs produced by QMainWindow::saveState().
+//
+// parse() decodes the dock section of the stream into flat arrays of docks
+// and dock area groups; serialize() writes them back byte for byte. The
+// toolbar section and anything after it is kept verbatim as the trailer.
+// The parser only depends on QtCore.
+namespace WindowState {
+
+// Order of QInternal::DockPosition
+enum DockArea : qint32 {
+    FloatingArea = -1, // Inside a floating tab group
+    LeftArea = 0,
+    RightArea = 1,
+    TopArea = 2,
+    BottomArea = 3,
+};
+
+// One dock widget, or the placeholder of a dock that did not exist when the
+// state was saved
+struct DockRecord {
+    QString objectName;
+    qint32 area = LeftArea;
+    qint32 group = -1;    // Containing group in State::groups
+    qint32 tabGroup = -1; // Same as group if that group is tabbed, else -1
+    bool visible = false;
+    bool floating = false;
+
+    // Floating docks: window geometry. Docked: position and extent along
+    // the containing group's orientation, plus the size limits Qt recorded.
+    QRect geometry;
+    qint32 pos = 0;
+    qint32 size = 0;
+    qint32 minimumSize = 0;
+    qint32 maximumSize = 0;
+};
+
+// A QDockAreaLayoutInfo: a splitter sequence or a tab group
+struct Group {
+    struct Item {
+        bool isGroup;
+        qint32 index; // Into State::groups or State::docks
+    };
+
+    qint32 parent = -1; // -1 for the root of an area or floating window
+    qint32 area = LeftArea;
+    bool tabbed = false;
+    qint32 currentTab = -1;
+    quint8 orientation = 0; // Qt::Orientation
+
+    // Place inside the parent group; unused for roots
+    qint32 pos = 0;
+    qint32 size = 0;
+    qint32 minimumSize = 0;
+    qint32 maximumSize = 0;
+
+    QVector<Item> items;
+};
+
+struct State {
+    struct Area {
+        qint32 area;
+        QSize size;
+        qint32 group;
+    };
+
+    struct FloatingWindow {
+        QRect geometry;
+        qint32 group;
+    };
+
+    qint32 version = 0; // The version passed to saveState()
+    QVector<Area> areas;
+    QSize centralSize;
+    qint32 corners[4] = {};
+    QVector<FloatingWindow> floatingWindows;
+
+    QVector<Group> groups;
+    QVector<DockRecord> docks;
+    QByteArray trailer;
+
+    int findDock(const QString &objectName) const;
+};
+
+// Returns false if the blob is not a dock layout this version understands
+bool parse(const QByteArray &data, State &state);
+
+QByteArray serialize(const State &state);
+
+// Unlinks the named docks from their groups, together with groups and
+// floating windows left empty; serialize() then leaves them out. Returns
+// the number of docks removed.
+int removeDocks(State &state, const QSet<QString> &objectNames);
+
+// Object names of every dock the state places, in stream order
+bool dockNames(const QByteArray &data, QStringList &names);
+
+} // namespace WindowState
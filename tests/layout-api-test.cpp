@@ -0,0 +1,367 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-api.hpp"
+#include "layout-store.hpp"
+#include "partial-layout.hpp"
+#include "restore-scheduler.hpp"
+#include "screen-config.hpp"
+
+#include <obs.h>
+
+#include <QDockWidget>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMainWindow>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTextEdit>
+
+using Operation = LayoutApi::Operation;
+
+struct Switched {
+    QString name;
+    bool success;
+    double durationMs;
+};
+
+static void on_switched(void *data, calldata_t *params)
+{
+    static_cast<QVector<Switched> *>(data)->append(Switched{QString::fromUtf8(calldata_string(params, "name")),
+                                                            calldata_bool(params, "success"),
+                                                            calldata_float(params, "duration_ms")});
+}
+
+// Stands in for the frontend, which runs UI tasks on its thread; the tests
+// call the procedures from that thread already
+static void run_task_inline(obs_task_t task, void *param, bool)
+{
+    task(param);
+}
+
+struct ProcResult {
+    bool called = false;
+    bool success = false;
+    QString error;
+};
+
+// Calls a procedure with one string argument that reports success and error
+static ProcResult call_proc(const char *proc, const char *param, const QString &value)
+{
+    calldata_t data;
+    calldata_init(&data);
+    calldata_set_string(&data, param, value.toUtf8().constData());
+
+    ProcResult result;
+    result.called = proc_handler_call(obs_get_proc_handler(), proc, &data);
+    result.success = calldata_bool(&data, "success");
+    result.error = QString::fromUtf8(calldata_string(&data, "error"));
+    calldata_free(&data);
+    return result;
+}
+
+// Calls a procedure without arguments and returns its string result
+static QString call_string_proc(const char *proc, const char *result)
+{
+    calldata_t data;
+    calldata_init(&data);
+    QString value;
+    if (proc_handler_call(obs_get_proc_handler(), proc, &data))
+        value = QString::fromUtf8(calldata_string(&data, result));
+    calldata_free(&data);
+    return value;
+}
+
+class LayoutApiTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QDockWidget *dock(const QString &name) const { return window->findChild<QDockWidget *>(name); }
+
+    // Saves the window as it is now under name, then goes back to the base
+    void saveWhole(const QString &name)
+    {
+        LayoutStore::instance().setWindowState(name, window->saveState(), ScreenConfig::instance().currentKey());
+        QVERIFY(window->restoreState(baseState));
+    }
+
+    bool waitForSwitch()
+    {
+        return !scheduler->isRunning() || finished->wait(5000);
+    }
+
+    QTemporaryDir directory;
+    QMainWindow *window = nullptr;
+    RestoreScheduler *scheduler = nullptr;
+    QSignalSpy *finished = nullptr;
+    QByteArray baseState;
+    QVector<Switched> switched;
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(obs_startup("en-US", nullptr, nullptr));
+        obs_set_ui_task_handler(run_task_inline);
+        QVERIFY(directory.isValid());
+        LayoutStore::instance().load(directory.filePath("layouts.db"), directory.filePath("layouts.ini"));
+        LayoutApi::instance().registerProcs();
+        signal_handler_connect(obs_get_signal_handler(), "dock_layout_switched", on_switched, &switched);
+
+        window = new QMainWindow();
+        window->resize(1280, 720);
+        window->setCentralWidget(new QTextEdit(window));
+        const Qt::DockWidgetArea areas[] = {Qt::LeftDockWidgetArea, Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea,
+                                            Qt::BottomDockWidgetArea};
+        for (int i = 0; i < 4; ++i) {
+            const QString name(QChar('a' + i));
+            QDockWidget *dockWidget = new QDockWidget(name, window);
+            dockWidget->setObjectName(name);
+            dockWidget->setWidget(new QTextEdit(dockWidget));
+            window->addDockWidget(areas[i], dockWidget);
+        }
+        window->show();
+        QVERIFY(QTest::qWaitForWindowExposed(window));
+        baseState = window->saveState();
+
+        scheduler = new RestoreScheduler(window);
+        finished = new QSignalSpy(scheduler, &RestoreScheduler::finished);
+        LayoutApi::instance().start(window, scheduler);
+    }
+
+    void cleanupTestCase()
+    {
+        signal_handler_disconnect(obs_get_signal_handler(), "dock_layout_switched", on_switched, &switched);
+        delete finished;
+        delete window;
+        LayoutStore::instance().shutdown();
+        obs_shutdown();
+    }
+
+    // Whole A: the base. Whole B: d hidden, c at the bottom. Partial P:
+    // only c, floating.
+    void init()
+    {
+        LayoutStore &store = LayoutStore::instance();
+        for (const QString &name : store.layoutNames())
+            store.removeLayout(name);
+        QVERIFY(window->restoreState(baseState));
+
+        saveWhole(QStringLiteral("Whole A"));
+
+        dock(QStringLiteral("d"))->hide();
+        window->addDockWidget(Qt::BottomDockWidgetArea, dock(QStringLiteral("c")));
+        saveWhole(QStringLiteral("Whole B"));
+
+        dock(QStringLiteral("c"))->setFloating(true);
+        dock(QStringLiteral("c"))->setGeometry(300, 300, 320, 200);
+        PartialLayout::setPlacements(QStringLiteral("Partial P"),
+                                     PartialLayout::capture(window, {QStringLiteral("c")}));
+        QVERIFY(window->restoreState(baseState));
+        QVERIFY(PartialLayout::isPartial(QStringLiteral("Partial P")));
+
+        scheduler->setCurrentLayout(QString());
+        finished->clear();
+        switched.clear();
+    }
+
+    void rejectsInvalidBatchBeforeAnythingRuns()
+    {
+        LayoutStore &store = LayoutStore::instance();
+        QString error;
+
+        // The save and delete come before the bad apply, and still do not run
+        QVERIFY(!LayoutApi::instance().run({{Operation::Save, QStringLiteral("New")},
+                                            {Operation::Delete, QStringLiteral("Whole A")},
+                                            {Operation::Apply, QStringLiteral("Missing")}},
+                                           error));
+        QVERIFY(error.contains(QStringLiteral("Missing")));
+
+        // Deleted earlier in the same batch
+        QVERIFY(!LayoutApi::instance().run(
+            {{Operation::Delete, QStringLiteral("Whole B")}, {Operation::Apply, QStringLiteral("Whole B")}}, error));
+        QVERIFY(!LayoutApi::instance().run({{Operation::Apply, QString()}}, error));
+
+        QVERIFY(!store.contains(QStringLiteral("New")));
+        QVERIFY(store.contains(QStringLiteral("Whole A")));
+        QVERIFY(store.contains(QStringLiteral("Whole B")));
+        QVERIFY(!scheduler->isRunning());
+        QVERIFY(finished->isEmpty());
+        QVERIFY(switched.isEmpty());
+        QVERIFY(scheduler->currentLayout().isEmpty());
+    }
+
+    void deletesRunBeforeTheApply()
+    {
+        LayoutStore &store = LayoutStore::instance();
+        QString error;
+
+        // Applies wait for the end of the batch, after the delete
+        QVERIFY(LayoutApi::instance().run(
+            {{Operation::Apply, QStringLiteral("Whole B")}, {Operation::Delete, QStringLiteral("Whole A")}}, error));
+        QVERIFY(!store.contains(QStringLiteral("Whole A")));
+        QVERIFY(waitForSwitch());
+        QCOMPARE(scheduler->currentLayout(), QStringLiteral("Whole B"));
+        QVERIFY(dock(QStringLiteral("d"))->isHidden());
+
+        // An applied layout deleted later in the batch is left out
+        finished->clear();
+        QVERIFY(LayoutApi::instance().run(
+            {{Operation::Apply, QStringLiteral("Partial P")}, {Operation::Delete, QStringLiteral("Partial P")}}, error));
+        QVERIFY(!store.contains(QStringLiteral("Partial P")));
+        QVERIFY(!scheduler->isRunning());
+        QVERIFY(finished->isEmpty());
+        QVERIFY(!dock(QStringLiteral("c"))->isFloating());
+    }
+
+    void wholeApplyReplacesEarlierPartials()
+    {
+        QString error;
+        QVERIFY(LayoutApi::instance().run(
+            {{Operation::Apply, QStringLiteral("Partial P")}, {Operation::Apply, QStringLiteral("Whole B")}}, error));
+        QVERIFY(waitForSwitch());
+        QCOMPARE(int(finished->size()), 1);
+        QCOMPARE(finished->first().at(0).toString(), QStringLiteral("Whole B"));
+        QVERIFY(!dock(QStringLiteral("c"))->isFloating());
+        QCOMPARE(scheduler->currentLayout(), QStringLiteral("Whole B"));
+
+        // Partials after the whole layout go on top of it, as one switch.
+        // One change per slice, so it is usually still running on return.
+        finished->clear();
+        scheduler->setSliceBudgetUs(0);
+        QVERIFY(LayoutApi::instance().run(
+            {{Operation::Apply, QStringLiteral("Whole A")}, {Operation::Apply, QStringLiteral("Partial P")}}, error));
+        if (scheduler->isRunning())
+            QCOMPARE(scheduler->currentLayout(), QStringLiteral("Whole B"));
+        QVERIFY(waitForSwitch());
+        scheduler->setSliceBudgetUs(RestoreScheduler::defaultSliceBudgetUs);
+        QCOMPARE(int(finished->size()), 1);
+        QCOMPARE(finished->first().at(0).toString(), QStringLiteral("Whole A + Partial P"));
+        QVERIFY(dock(QStringLiteral("c"))->isFloating());
+        QVERIFY(!dock(QStringLiteral("d"))->isHidden());
+        QCOMPARE(scheduler->currentLayout(), QStringLiteral("Whole A"));
+    }
+
+    void announcesSwitchesOnTheSignalHandler()
+    {
+        QString error;
+        QVERIFY(LayoutApi::instance().run({{Operation::Apply, QStringLiteral("Whole B")}}, error));
+        QVERIFY(waitForSwitch());
+
+        QCOMPARE(int(switched.size()), 1);
+        QCOMPARE(switched.first().name, QStringLiteral("Whole B"));
+        QVERIFY(switched.first().success);
+        QVERIFY(switched.first().durationMs > 0.0);
+        QCOMPARE(switched.first().durationMs, scheduler->lastDurationNs() / 1e6);
+    }
+
+    void procListReturnsLayoutsAsJson()
+    {
+        LayoutStore::instance().setDefaultLayout(QStringLiteral("Whole A"));
+        const QJsonObject root =
+            QJsonDocument::fromJson(call_string_proc("dock_layout_manager_list", "layouts").toUtf8()).object();
+        LayoutStore::instance().setDefaultLayout(QString());
+
+        QCOMPARE(root.value("default").toString(), QStringLiteral("Whole A"));
+        const QJsonArray layouts = root.value("layouts").toArray();
+        QCOMPARE(int(layouts.size()), 3);
+
+        QHash<QString, bool> partial;
+        for (const QJsonValue &value : layouts)
+            partial.insert(value.toObject().value("name").toString(), value.toObject().value("partial").toBool());
+        QCOMPARE(partial.value(QStringLiteral("Partial P"), false), true);
+        QCOMPARE(partial.value(QStringLiteral("Whole A"), true), false);
+        QCOMPARE(partial.value(QStringLiteral("Whole B"), true), false);
+    }
+
+    void procApplyAndGetCurrent()
+    {
+        ProcResult result = call_proc("dock_layout_manager_apply", "name", QStringLiteral("Missing"));
+        QVERIFY(result.called);
+        QVERIFY(!result.success);
+        QVERIFY(result.error.contains(QStringLiteral("Missing")));
+
+        result = call_proc("dock_layout_manager_apply", "name", QStringLiteral(" Whole B "));
+        QVERIFY(result.called);
+        QVERIFY(result.success);
+        QVERIFY(result.error.isEmpty());
+        QVERIFY(waitForSwitch());
+
+        QCOMPARE(call_string_proc("dock_layout_manager_get_current", "name"), QStringLiteral("Whole B"));
+        QVERIFY(dock(QStringLiteral("d"))->isHidden());
+    }
+
+    void procSaveAndDelete()
+    {
+        LayoutStore &store = LayoutStore::instance();
+
+        ProcResult result = call_proc("dock_layout_manager_save", "name", QStringLiteral("New"));
+        QVERIFY(result.called);
+        QVERIFY(result.success);
+        QVERIFY(store.contains(QStringLiteral("New")));
+
+        result = call_proc("dock_layout_manager_delete", "name", QStringLiteral("New"));
+        QVERIFY(result.success);
+        QVERIFY(!store.contains(QStringLiteral("New")));
+
+        result = call_proc("dock_layout_manager_delete", "name", QStringLiteral("New"));
+        QVERIFY(!result.success);
+        QVERIFY(!result.error.isEmpty());
+
+        result = call_proc("dock_layout_manager_save", "name", QStringLiteral("   "));
+        QVERIFY(!result.success);
+        QVERIFY(!result.error.isEmpty());
+    }
+
+    void procBatchRejectsMalformedOperations()
+    {
+        const QString rejected[] = {
+            QStringLiteral("not json"),
+            QStringLiteral("{\"op\": \"apply\", \"layout\": \"Whole A\"}"),
+            QStringLiteral("[{\"op\": \"rename\", \"layout\": \"Whole A\"}]"),
+            QStringLiteral("[{\"op\": \"delete\", \"layout\": \"Whole A\"}, {\"op\": \"apply\"}]"),
+            QStringLiteral("[{\"op\": \"delete\", \"layout\": \"Whole A\"}, \"apply\"]"),
+        };
+        for (const QString &operations : rejected) {
+            const ProcResult result = call_proc("dock_layout_manager_batch", "operations", operations);
+            QVERIFY(result.called);
+            QVERIFY2(!result.success, qPrintable(operations));
+            QVERIFY2(!result.error.isEmpty(), qPrintable(operations));
+        }
+
+        ProcResult result = call_proc("dock_layout_manager_batch", "operations",
+                                      QStringLiteral("[{\"op\": \"rename\", \"layout\": \"Whole A\"}]"));
+        QVERIFY(result.error.contains(QStringLiteral("rename")));
+        result = call_proc("dock_layout_manager_batch", "operations", QStringLiteral("{}"));
+        QCOMPARE(result.error, QStringLiteral("operations must be a JSON array"));
+
+        QVERIFY(LayoutStore::instance().contains(QStringLiteral("Whole A")));
+        QVERIFY(!scheduler->isRunning());
+        QVERIFY(finished->isEmpty());
+    }
+
+    void procBatchRuns()
+    {
+        const ProcResult result = call_proc(
+            "dock_layout_manager_batch", "operations",
+            QStringLiteral("[{\"op\": \"delete\", \"layout\": \"Whole A\"}, {\"op\": \"apply\", \"layout\": "
+                           "\"Whole B\"}, {\"op\": \"apply\", \"layout\": \"Partial P\"}]"));
+        QVERIFY(result.called);
+        QVERIFY(result.success);
+        QVERIFY(result.error.isEmpty());
+        QVERIFY(!LayoutStore::instance().contains(QStringLiteral("Whole A")));
+
+        QVERIFY(waitForSwitch());
+        QCOMPARE(int(finished->size()), 1);
+        QCOMPARE(finished->first().at(0).toString(), QStringLiteral("Whole B + Partial P"));
+        QCOMPARE(call_string_proc("dock_layout_manager_get_current", "name"), QStringLiteral("Whole B"));
+        QVERIFY(dock(QStringLiteral("c"))->isFloating());
+    }
+};
+
+QTEST_MAIN(LayoutApiTest)
+#include "layout-api-test.moc"
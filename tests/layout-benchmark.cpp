@@ -0,0 +1,355 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-bundle.hpp"
+#include "layout-list-model.hpp"
+#include "layout-store.hpp"
+#include "layout-thumbnails.hpp"
+#include "prepared-layout.hpp"
+#include "restore-scheduler.hpp"
+#include "screen-config.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMainWindow>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextEdit>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Headless timings of the paths a user waits on: saving a layout, switching
+// to one, filling the dialog's list, renaming, restoring the default at
+// startup and importing a large bundle.
+// Runs a synthetic main window with N docks against a temporary store of
+// M layouts and writes the results as JSON, with the heap allocations the
+// UI thread made during each timed call.
+
+// Allocations of the calling thread; workers such as the store's writer
+// are left out
+static thread_local quint64 threadAllocations = 0;
+
+void *operator new(std::size_t size)
+{
+    ++threadAllocations;
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+struct Sample {
+    qint64 ns;
+    quint64 allocations;
+};
+
+template<typename Call> static Sample measure(Call call)
+{
+    const quint64 allocationsBefore = threadAllocations;
+    QElapsedTimer timer;
+    timer.start();
+    call();
+    const qint64 ns = timer.nsecsElapsed();
+    return Sample{ns, threadAllocations - allocationsBefore};
+}
+
+static const Qt::DockWidgetArea dockAreas[] = {Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea,
+                                                Qt::BottomDockWidgetArea, Qt::TopDockWidgetArea};
+
+static QVector<QDockWidget *> build_window(QMainWindow &window, int dockCount)
+{
+    window.resize(1920, 1080);
+    window.setCentralWidget(new QTextEdit(&window));
+
+    // Every third dock is a tab of the one before it, like OBS's defaults
+    QVector<QDockWidget *> docks;
+    for (int i = 0; i < dockCount; ++i) {
+        QDockWidget *dock = new QDockWidget(QStringLiteral("Dock %1").arg(i), &window);
+        dock->setObjectName(QStringLiteral("dock%1").arg(i));
+        dock->setWidget(new QTextEdit(dock));
+        window.addDockWidget(dockAreas[(i / 3) % 4], dock);
+        if (i % 3 == 2)
+            window.tabifyDockWidget(docks.last(), dock);
+        docks.append(dock);
+    }
+
+    window.show();
+    return docks;
+}
+
+// Reshapes the window into layout `seed`: some docks hidden, sizes moved,
+// other tabs raised, and now and then a floating dock
+static void vary_window(QMainWindow &window, const QVector<QDockWidget *> &docks, quint32 seed)
+{
+    QRandomGenerator random(seed);
+
+    QList<QDockWidget *> resized;
+    QList<int> sizes;
+    for (QDockWidget *dock : docks) {
+        const bool floating = seed % 10 == 0 && dock == docks.first();
+        if (dock->isFloating() != floating)
+            dock->setFloating(floating);
+        if (floating)
+            dock->setGeometry(200 + random.bounded(400), 200 + random.bounded(200), 400, 300);
+
+        dock->setVisible(random.bounded(5) > 0);
+        if (dock->isVisible() && !floating) {
+            resized.append(dock);
+            sizes.append(150 + random.bounded(250));
+        }
+        if (random.bounded(3) == 0)
+            dock->raise();
+    }
+    window.resizeDocks(resized, sizes, Qt::Horizontal);
+    QCoreApplication::processEvents();
+}
+
+static QJsonObject summarize(const QVector<Sample> &samples)
+{
+    QJsonObject summary;
+    summary["count"] = int(samples.size());
+    if (samples.isEmpty())
+        return summary;
+
+    QVector<qint64> ns;
+    QVector<quint64> allocations;
+    qint64 totalNs = 0;
+    quint64 totalAllocations = 0;
+    for (const Sample &sample : samples) {
+        ns.append(sample.ns);
+        allocations.append(sample.allocations);
+        totalNs += sample.ns;
+        totalAllocations += sample.allocations;
+    }
+    std::sort(ns.begin(), ns.end());
+    std::sort(allocations.begin(), allocations.end());
+
+    auto at = [&samples](double p) { return std::min(int(samples.size()) - 1, int(p * samples.size())); };
+    summary["total_ms"] = totalNs / 1e6;
+    summary["mean_us"] = totalNs / 1e3 / samples.size();
+    summary["p50_us"] = ns[at(0.5)] / 1e3;
+    summary["p95_us"] = ns[at(0.95)] / 1e3;
+    summary["p99_us"] = ns[at(0.99)] / 1e3;
+    summary["max_us"] = ns.last() / 1e3;
+    summary["allocs_mean"] = double(totalAllocations) / samples.size();
+    summary["allocs_p50"] = double(allocations[at(0.5)]);
+    summary["allocs_p99"] = double(allocations[at(0.99)]);
+    summary["allocs_max"] = double(allocations.last());
+    return summary;
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption docksOption("docks", "Docks in the main window.", "count", "30");
+    const QCommandLineOption layoutsOption("layouts", "Layouts saved into the store.", "count", "500");
+    const QCommandLineOption switchesOption("switches", "Layout switches to time.", "count", "200");
+    const QCommandLineOption importsOption("imports", "Layouts in the imported bundle.", "count", "10000");
+    const QCommandLineOption outputOption("output", "JSON results file.", "path", "bench_output.txt");
+    parser.addOptions({docksOption, layoutsOption, switchesOption, importsOption, outputOption});
+    parser.process(app);
+
+    const int dockCount = std::max(1, parser.value(docksOption).toInt());
+    const int layoutCount = std::max(1, parser.value(layoutsOption).toInt());
+    const int switchCount = std::max(1, parser.value(switchesOption).toInt());
+    const int importCount = std::max(1, parser.value(importsOption).toInt());
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        fprintf(stderr, "Cannot create a temporary directory\n");
+        return 1;
+    }
+
+    LayoutStore &store = LayoutStore::instance();
+    store.load(directory.filePath("layouts.db"), directory.filePath("layouts.ini"));
+
+    QMainWindow window;
+    const QVector<QDockWidget *> docks = build_window(window, dockCount);
+    const QString screenKey = ScreenConfig::instance().currentKey();
+    QCoreApplication::processEvents();
+
+    QJsonObject results;
+    results["docks"] = dockCount;
+    results["layouts"] = layoutCount;
+
+    // Save: what the dialog's New and Save buttons do
+    QStringList names;
+    QVector<Sample> samples;
+    for (int i = 0; i < layoutCount; ++i) {
+        vary_window(window, docks, quint32(i));
+        const QString name = QStringLiteral("Layout %1").arg(i, 5, 10, QChar('0'));
+
+        samples.append(measure([&]() { store.setWindowState(name, window.saveState(), screenKey); }));
+        names.append(name);
+    }
+    results["save"] = summarize(samples);
+
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+    store.flush();
+    results["flush_ms"] = flushTimer.nsecsElapsed() / 1e6;
+
+    // Restore: a switch from the dialog, from the store read to the repaint
+    RestoreScheduler scheduler(&window);
+    bool switchDone = false;
+    bool switchOk = false;
+    QEventLoop loop;
+    QObject::connect(&scheduler, &RestoreScheduler::finished, &loop, [&](const QString &, bool ok) {
+        switchDone = true;
+        switchOk = ok;
+        loop.quit();
+    });
+
+    samples.clear();
+    int failedSwitches = 0;
+    QRandomGenerator order(1);
+    for (int i = 0; i < switchCount; ++i) {
+        const QString &name = names.at(order.bounded(int(names.size())));
+        switchDone = false;
+
+        samples.append(measure([&]() {
+            scheduler.switchTo(name, store.windowState(name, screenKey));
+            if (!switchDone)
+                loop.exec();
+        }));
+        if (!switchOk)
+            ++failedSwitches;
+    }
+    results["restore"] = summarize(samples);
+    results["restore_failures"] = failedSwitches;
+
+    // List: filling the dialog's model and reading what the view paints
+    samples.clear();
+    for (int i = 0; i < 20; ++i) {
+        samples.append(measure([]() {
+            LayoutListModel model;
+            for (int row = 0; row < model.rowCount(); ++row) {
+                const QModelIndex index = model.index(row);
+                model.data(index, Qt::DisplayRole);
+                model.data(index, Qt::FontRole);
+            }
+        }));
+    }
+    results["list"] = summarize(samples);
+
+    // Rename: the dialog's Rename button, with its list following the store
+    samples.clear();
+    {
+        LayoutListModel model;
+        for (QString &name : names) {
+            const QString newName = QStringLiteral("Renamed %1").arg(name);
+            bool renamed = false;
+            samples.append(measure([&]() { renamed = store.renameLayout(name, newName); }));
+            if (!renamed) {
+                fprintf(stderr, "Renaming '%s' failed\n", name.toUtf8().constData());
+                return 1;
+            }
+            name = newName;
+        }
+    }
+    results["rename"] = summarize(samples);
+
+    // Startup restore: preparing the default layout and applying it
+    store.setDefaultLayout(names.first());
+    samples.clear();
+    for (int i = 0; i < 20; ++i) {
+        window.restoreState(store.windowState(names[(i + 1) % names.size()], screenKey));
+        QCoreApplication::processEvents();
+
+        PreparedLayout layout;
+        bool restored = false;
+        samples.append(measure([&]() {
+            layout = PreparedLayout::prepare(store.defaultLayout(), screenKey);
+            restored = layout.valid && window.restoreState(layout.windowState);
+        }));
+        if (!restored) {
+            fprintf(stderr, "Startup restore of '%s' failed\n", layout.name.toUtf8().constData());
+            return 1;
+        }
+    }
+    results["startup_restore"] = summarize(samples);
+
+    // Import: a bundle read on the worker while the dialog's list follows
+    QStringList bundled;
+    LayoutStore::LayoutBatch batch;
+    for (int i = 0; i < importCount; ++i) {
+        const QString name = QStringLiteral("Imported %1").arg(i, 5, 10, QChar('0'));
+        batch.append(qMakePair(name, store.values(names.at(i % names.size()))));
+        bundled.append(name);
+    }
+    store.setLayouts(batch);
+    batch.clear();
+
+    QString error;
+    const QString bundlePath = directory.filePath("bundle.odlb");
+    if (!LayoutBundle::exportLayouts(bundlePath, bundled, error)) {
+        fprintf(stderr, "Cannot export the bundle: %s\n", error.toUtf8().constData());
+        return 1;
+    }
+    for (const QString &name : bundled)
+        store.removeLayout(name);
+
+    {
+        LayoutListModel model;
+        LayoutBundle::ImportResult imported;
+        QEventLoop importLoop;
+        const Sample sample = measure([&]() {
+            LayoutBundle::importLayouts(bundlePath, LayoutBundle::ConflictPolicy::Overwrite, &importLoop,
+                                        [&](const LayoutBundle::ImportResult &result) {
+                                            imported = result;
+                                            importLoop.quit();
+                                        });
+            importLoop.exec();
+        });
+
+        // The worker's reading is not counted, only the UI thread's share
+        QJsonObject import;
+        import["layouts"] = imported.imported;
+        import["total_ms"] = sample.ns / 1e6;
+        import["allocs"] = double(sample.allocations);
+        import["rows"] = model.rowCount();
+        results["import"] = import;
+        if (imported.imported != importCount || !imported.error.isEmpty()) {
+            fprintf(stderr, "Imported %d of %d layouts: %s\n", imported.imported, importCount,
+                    imported.error.toUtf8().constData());
+            return 1;
+        }
+    }
+
+    LayoutThumbnails::instance().shutdown();
+    LayoutBundle::shutdown();
+    store.shutdown();
+
+    const QByteArray json = QJsonDocument(results).toJson();
+    QFile output(parser.value(outputOption));
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) || output.write(json) != json.size()) {
+        fprintf(stderr, "Cannot write '%s'\n", output.fileName().toUtf8().constData());
+        return 1;
+    }
+    fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    return failedSwitches > 0 ? 1 : 0;
+}
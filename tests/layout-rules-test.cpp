@@ -0,0 +1,71 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "layout-rules.hpp"
+#include "layout-store.hpp"
+
+#include <obs.h>
+
+#include <QTemporaryDir>
+#include <QTest>
+
+using Trigger = LayoutRules::Trigger;
+
+class LayoutRulesTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir directory;
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(obs_startup("en-US", nullptr, nullptr));
+        QVERIFY(directory.isValid());
+        LayoutStore::instance().load(directory.filePath("layouts.db"), directory.filePath("layouts.ini"));
+
+        LayoutRules &rules = LayoutRules::instance();
+        rules.setRules({{Trigger::SceneChanged, QStringLiteral("A"), QStringLiteral("Layout A")},
+                        {Trigger::SceneChanged, QStringLiteral("Live*"), QStringLiteral("Layout Live")}});
+        rules.start();
+    }
+
+    void cleanupTestCase()
+    {
+        LayoutRules::instance().stop();
+        LayoutStore::instance().shutdown();
+        obs_shutdown();
+    }
+
+    void cleanup() { LayoutRules::instance().stop(); }
+
+    void lastMatchOfBurstWins()
+    {
+        LayoutRules &rules = LayoutRules::instance();
+        rules.start();
+        rules.queueSwitch(Trigger::SceneChanged, QStringLiteral("A"));
+        rules.queueSwitch(Trigger::SceneChanged, QStringLiteral("Live 2"));
+        QCOMPARE(rules.pendingSwitch(), QStringLiteral("Layout Live"));
+    }
+
+    // A fast cut from a scene with a rule to one without must not switch
+    void missAtEndOfBurstCancels()
+    {
+        LayoutRules &rules = LayoutRules::instance();
+        rules.start();
+        rules.queueSwitch(Trigger::SceneChanged, QStringLiteral("A"));
+        QCOMPARE(rules.pendingSwitch(), QStringLiteral("Layout A"));
+
+        rules.queueSwitch(Trigger::SceneChanged, QStringLiteral("B"));
+        QVERIFY(rules.pendingSwitch().isEmpty());
+
+        // And a later match still queues
+        rules.queueSwitch(Trigger::SceneChanged, QStringLiteral("a"));
+        QCOMPARE(rules.pendingSwitch(), QStringLiteral("Layout A"));
+    }
+};
+
+QTEST_MAIN(LayoutRulesTest)
+#include "layout-rules-test.moc"
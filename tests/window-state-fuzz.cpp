@@ -0,0 +1,37 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "window-state.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+
+using namespace WindowState;
+
+// Every blob the plugin reads comes from the store or a bundle, so parse()
+// must cope with anything. Whatever it accepts has to serialize into a
+// blob that parses back to the same bytes, also after docks are removed.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    const QByteArray input = QByteArray::fromRawData(reinterpret_cast<const char *>(data), qsizetype(size));
+
+    State state;
+    if (!parse(input, state))
+        return 0;
+
+    const QByteArray written = serialize(state);
+    State reparsed;
+    if (!parse(written, reparsed) || serialize(reparsed) != written)
+        abort();
+
+    if (state.docks.isEmpty())
+        return 0;
+
+    removeDocks(reparsed, {state.docks.first().objectName});
+    const QByteArray stripped = serialize(reparsed);
+    State strippedState;
+    if (!parse(stripped, strippedState) || serialize(strippedState) != stripped)
+        abort();
+    return 0;
+}
@@ -0,0 +1,295 @@
+/*
+OBS Dock Layout Manager
+*/
+
+#include "window-state.hpp"
+
+#include <QDataStream>
+#include <QDockWidget>
+#include <QMainWindow>
+#include <QTest>
+#include <QTextEdit>
+
+using namespace WindowState;
+
+// Markers of the dock section, as written by QMainWindow
+static constexpr qint32 versionMarker = 0xff;
+static constexpr quint8 dockWidgetStateMarker = 0xfd;
+static constexpr quint8 sequenceMarker = 0xfc;
+static constexpr quint8 tabMarker = 0xfa;
+static constexpr quint8 widgetMarker = 0xfb;
+
+static QDockWidget *add_dock(QMainWindow &window, const QString &name, Qt::DockWidgetArea area)
+{
+    QDockWidget *dock = new QDockWidget(name, &window);
+    dock->setObjectName(name);
+    dock->setWidget(new QTextEdit(dock));
+    window.addDockWidget(area, dock);
+    return dock;
+}
+
+// A main window like OBS's: a nested splitter on the left, tabs at the
+// bottom and on the right, and a floating dock
+static void build_window(QMainWindow &window)
+{
+    window.resize(1280, 720);
+    window.setCentralWidget(new QTextEdit(&window));
+
+    add_dock(window, QStringLiteral("scenes"), Qt::LeftDockWidgetArea);
+    QDockWidget *sources = add_dock(window, QStringLiteral("sources"), Qt::LeftDockWidgetArea);
+    QDockWidget *transitions = add_dock(window, QStringLiteral("transitions"), Qt::RightDockWidgetArea);
+    window.splitDockWidget(sources, transitions, Qt::Horizontal);
+
+    QDockWidget *mixer = add_dock(window, QStringLiteral("mixer"), Qt::BottomDockWidgetArea);
+    QDockWidget *controls = add_dock(window, QStringLiteral("controls"), Qt::BottomDockWidgetArea);
+    window.tabifyDockWidget(mixer, controls);
+
+    add_dock(window, QStringLiteral("log"), Qt::RightDockWidgetArea);
+    QDockWidget *stats = add_dock(window, QStringLiteral("stats"), Qt::RightDockWidgetArea);
+    QDockWidget *chat = add_dock(window, QStringLiteral("chat"), Qt::RightDockWidgetArea);
+    window.tabifyDockWidget(stats, chat);
+
+    QDockWidget *browser = add_dock(window, QStringLiteral("browser"), Qt::TopDockWidgetArea);
+    browser->setFloating(true);
+    browser->setGeometry(100, 100, 320, 240);
+
+    window.show();
+}
+
+template<typename Write> static QByteArray write_stream(Write write)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    write(stream);
+    return data;
+}
+
+// A valid state whose left area nests `depth` splitters below its root
+static QByteArray nested_state(int depth)
+{
+    return write_stream([depth](QDataStream &stream) {
+        stream << versionMarker << qint32(0) << dockWidgetStateMarker << qint32(1);
+        stream << qint32(LeftArea) << QSize(200, 400);
+        for (int i = 0; i < depth; ++i) {
+            stream << sequenceMarker << quint8(Qt::Vertical) << qint32(1);
+            stream << sequenceMarker << qint32(0) << qint32(200) << qint32(50) << qint32(0xffffff);
+        }
+        stream << sequenceMarker << quint8(Qt::Vertical) << qint32(0);
+        stream << QSize(800, 600) << qint32(TopArea) << qint32(TopArea) << qint32(BottomArea) << qint32(BottomArea);
+    });
+}
+
+// Start of a dock section with one area, up to its root group
+static void write_area_header(QDataStream &stream)
+{
+    stream << versionMarker << qint32(0) << dockWidgetStateMarker << qint32(1) << qint32(LeftArea) << QSize(200, 400);
+}
+
+class WindowStateTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    static bool roundTrips(const QByteArray &blob)
+    {
+        State state;
+        return parse(blob, state) && serialize(state) == blob;
+    }
+
+private slots:
+    void roundTripsNestedSplitters()
+    {
+        QMainWindow window;
+        build_window(window);
+        QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+        const QByteArray blob = window.saveState();
+        State state;
+        QVERIFY(parse(blob, state));
+        QCOMPARE(serialize(state), blob);
+
+        const int transitions = state.findDock(QStringLiteral("transitions"));
+        QVERIFY(transitions >= 0);
+        const Group &group = state.groups[state.docks[transitions].group];
+        QVERIFY(!group.tabbed);
+        QVERIFY(group.parent >= 0);
+        QCOMPARE(state.docks[transitions].area, qint32(LeftArea));
+    }
+
+    void roundTripsTabs()
+    {
+        QMainWindow window;
+        build_window(window);
+        QVERIFY(QTest::qWaitForWindowExposed(&window));
+        window.findChild<QDockWidget *>(QStringLiteral("controls"))->raise();
+
+        const QByteArray blob = window.saveState();
+        State state;
+        QVERIFY(parse(blob, state));
+        QCOMPARE(serialize(state), blob);
+
+        const DockRecord &mixer = state.docks[state.findDock(QStringLiteral("mixer"))];
+        const DockRecord &controls = state.docks[state.findDock(QStringLiteral("controls"))];
+        QVERIFY(mixer.tabGroup >= 0);
+        QCOMPARE(controls.tabGroup, mixer.tabGroup);
+        QCOMPARE(int(state.groups[mixer.tabGroup].items.size()), 2);
+
+        const DockRecord &browser = state.docks[state.findDock(QStringLiteral("browser"))];
+        QVERIFY(browser.floating);
+    }
+
+    void roundTripsFloatingTabGroups()
+    {
+        QMainWindow window;
+        window.setDockOptions(window.dockOptions() | QMainWindow::GroupedDragging);
+        build_window(window);
+        QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+        // Qt only creates floating tab groups by dragging, so move the
+        // stats and chat tabs into one and let Qt save it again
+        State state;
+        QVERIFY(parse(window.saveState(), state));
+        const qint32 tabGroup = state.docks[state.findDock(QStringLiteral("chat"))].tabGroup;
+        QVERIFY(tabGroup >= 0);
+
+        Group &parent = state.groups[state.groups[tabGroup].parent];
+        for (int i = 0; i < parent.items.size(); ++i) {
+            if (parent.items[i].isGroup && parent.items[i].index == tabGroup)
+                parent.items.removeAt(i--);
+        }
+        state.groups[tabGroup].parent = -1;
+        state.groups[tabGroup].area = FloatingArea;
+        state.floatingWindows.append({QRect(300, 200, 400, 300), tabGroup});
+        QVERIFY(window.restoreState(serialize(state)));
+
+        const QByteArray blob = window.saveState();
+        State floating;
+        QVERIFY(parse(blob, floating));
+        QCOMPARE(serialize(floating), blob);
+        QCOMPARE(int(floating.floatingWindows.size()), 1);
+
+        const Group &group = floating.groups[floating.floatingWindows[0].group];
+        QVERIFY(group.tabbed);
+        QCOMPARE(int(group.items.size()), 2);
+        QCOMPARE(floating.docks[floating.findDock(QStringLiteral("chat"))].area, qint32(FloatingArea));
+    }
+
+    void removeDocksKeepsStateRestorable()
+    {
+        QMainWindow window;
+        window.setDockOptions(window.dockOptions() | QMainWindow::GroupedDragging);
+        build_window(window);
+        QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+        State state;
+        QVERIFY(parse(window.saveState(), state));
+        const QSet<QString> removed{QStringLiteral("transitions"), QStringLiteral("stats"), QStringLiteral("chat"),
+                                    QStringLiteral("absent")};
+        QCOMPARE(removeDocks(state, removed), 3);
+
+        const QByteArray blob = serialize(state);
+        State stripped;
+        QVERIFY(parse(blob, stripped));
+        QCOMPARE(serialize(stripped), blob);
+        for (const QString &name : removed)
+            QCOMPARE(stripped.findDock(name), -1);
+        QVERIFY(stripped.findDock(QStringLiteral("log")) >= 0);
+        QVERIFY(window.restoreState(blob));
+    }
+
+    void truncatedInputIsRejectedOrExact()
+    {
+        QMainWindow window;
+        build_window(window);
+        QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+        // Whatever a prefix parses into has to account for every byte of it
+        const QByteArray blob = window.saveState();
+        for (int length = 0; length < blob.size(); ++length) {
+            const QByteArray prefix = blob.left(length);
+            State state;
+            if (parse(prefix, state))
+                QCOMPARE(serialize(state), prefix);
+        }
+    }
+
+    void rejectsMalformedHeaders()
+    {
+        State state;
+        QVERIFY(!parse(QByteArray(), state));
+
+        QVERIFY(!parse(write_stream([](QDataStream &stream) {
+                           stream << qint32(0xfe) << qint32(0) << dockWidgetStateMarker << qint32(0);
+                       }),
+                       state));
+        QVERIFY(!parse(write_stream([](QDataStream &stream) {
+                           stream << versionMarker << qint32(0) << quint8(0xfe) << qint32(0);
+                       }),
+                       state));
+
+        for (qint32 areaCount : {-1, 5, 0x7fffffff}) {
+            QVERIFY(!parse(write_stream([areaCount](QDataStream &stream) {
+                               stream << versionMarker << qint32(0) << dockWidgetStateMarker << areaCount;
+                           }),
+                           state));
+        }
+
+        for (qint32 area : {-1, 4}) {
+            QVERIFY(!parse(write_stream([area](QDataStream &stream) {
+                               stream << versionMarker << qint32(0) << dockWidgetStateMarker << qint32(1) << area
+                                      << QSize(200, 400) << sequenceMarker << quint8(Qt::Vertical) << qint32(0);
+                           }),
+                           state));
+        }
+    }
+
+    void rejectsMalformedGroups()
+    {
+        State state;
+
+        // Unknown group marker
+        QVERIFY(!parse(write_stream([](QDataStream &stream) {
+                           write_area_header(stream);
+                           stream << quint8(0x42) << quint8(Qt::Vertical) << qint32(0);
+                       }),
+                       state));
+
+        // Negative and unbacked item counts
+        for (qint32 itemCount : {-1, 0x7fffffff}) {
+            QVERIFY(!parse(write_stream([itemCount](QDataStream &stream) {
+                               write_area_header(stream);
+                               stream << sequenceMarker << quint8(Qt::Vertical) << itemCount;
+                           }),
+                           state));
+        }
+
+        // Unknown item marker
+        QVERIFY(!parse(write_stream([](QDataStream &stream) {
+                           write_area_header(stream);
+                           stream << tabMarker << qint32(0) << quint8(Qt::Horizontal) << qint32(1) << quint8(0x42);
+                       }),
+                       state));
+
+        // A dock cut off in the middle of its record
+        QVERIFY(!parse(write_stream([](QDataStream &stream) {
+                           write_area_header(stream);
+                           stream << sequenceMarker << quint8(Qt::Vertical) << qint32(1) << widgetMarker
+                                  << QStringLiteral("scenes") << quint8(1) << qint32(0);
+                       }),
+                       state));
+    }
+
+    void limitsNestingDepth()
+    {
+        QVERIFY(roundTrips(nested_state(0)));
+        QVERIFY(roundTrips(nested_state(32)));
+
+        State state;
+        QVERIFY(!parse(nested_state(33), state));
+        QVERIFY(!parse(nested_state(10000), state));
+    }
+};
+
+QTEST_MAIN(WindowStateTest)
+#include "window-state-test.moc"